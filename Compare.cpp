@@ -0,0 +1,157 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Compare.h"
+#include "Console.h"
+#include "Export.h"
+#include "Snapshot.h"
+#include <QRegExp>
+#include <QStringList>
+#include <QTime>
+
+namespace Compare {
+
+Git::SHA1 revParse(const QString &dir, const QString &revision)
+{
+    // a single commit, or nothing: the revision is never split or read as an option
+    bool ok = false;
+    QStringList arguments = QStringList() << "rev-parse" << "--verify" << "--quiet" << revision + "^{commit}";
+    QString sha1 = QString(Console::readCommandOutput(dir, "git", arguments, &ok)).trimmed();
+    return ok && isSha1(sha1) ? sha1 : QString();
+}
+
+bool isSha1(const QString &text)
+{
+    QRegExp sha1Rx("[0-9a-f]{40}");
+    return sha1Rx.exactMatch(text);
+}
+
+bool isAncestor(const QString &dir, const Git::SHA1 &ancestor, const Git::SHA1 &descendant)
+{
+    QStringList arguments = QStringList() << "merge-base" << ancestor << descendant;
+    return QString(Console::readCommandOutput(dir, "git", arguments)).trimmed() == ancestor;
+}
+
+Git::BranchHistory loadHistory(const QString &dir, const QString &branch, const Git::SHA1 &tip, bool *ok)
+{
+    if (ok)
+        *ok = true;
+
+    // start from the snapshot, if still valid
+    QString snapshotFileName = Snapshot::fileName(dir, branch);
+    Git::BranchHistory history;
+    Git::SHA1 snapshotTip;
+    if (Snapshot::load(snapshotFileName, &history, &snapshotTip)) {
+        if (snapshotTip == tip)
+            return history;
+
+        // only the commits newer than the snapshot are needed
+        if (isSha1(snapshotTip) && isAncestor(dir, snapshotTip, tip)) {
+            bool logOk = false;
+            QByteArray commits = Console::readCommandOutput(dir, Git::logCommand(tip + " ^" + snapshotTip), &logOk,
+                                                            false, 0, logTimeout);
+            if (logOk) {
+                Git::BranchHistory page = Git::parseLogToHistory(commits);
+                Git::prependHistory(&history, &page);
+                Snapshot::save(snapshotFileName, history, tip);
+                return history;
+            }
+        }
+        history.clear();
+    }
+
+    // the whole log otherwise, never saved if incomplete
+    bool logOk = false;
+    QByteArray commits = Console::readCommandOutput(dir, Git::logCommand(tip), &logOk, false, 0, logTimeout);
+    if (!logOk) {
+        qWarning("Compare::loadHistory: can't read the log of %s", qPrintable(branch));
+        if (ok)
+            *ok = false;
+        return Git::BranchHistory();
+    }
+    history = Git::parseLogToHistory(commits);
+    Snapshot::save(snapshotFileName, history, tip);
+    return history;
+}
+
+int computeEdgeStats(const QString &dir, Git::BranchHistory *history, QMap<QString, QString> *edgeStats,
+                     int budget, Export::Writer *exportWriter, Progress *progress, int progressFrom, int progressTo)
+{
+    // the whole work has to fit in the budget, if any
+    QTime timing;
+    timing.start();
+
+    QStringList edgesDiffs = history->scheduledEdgeDiffs();
+    int edgeDiffsCount = edgesDiffs.size(), edgeDiffsIdx = 0, pendingCount = 0;
+    foreach (const QString &diff, edgesDiffs) {
+        if (progress)
+            progress->setProgress(progressFrom + ((progressTo - progressFrom) * edgeDiffsIdx++) / edgeDiffsCount);
+
+        // reuse the stats of edges already computed
+        if (edgeStats->contains(diff)) {
+            history->edgeDataMap[diff] = edgeStats->value(diff);
+            if (exportWriter)
+                exportWriter->writeEdge(diff, edgeStats->value(diff));
+            continue;
+        }
+
+        // leave the rest for the next run when out of time
+        int timeout = 60000;
+        if (budget != 0) {
+            timeout = qMin(timeout, budget - timing.elapsed());
+            if (timeout <= 0) {
+                ++pendingCount;
+                continue;
+            }
+        }
+
+        bool ok = false;
+        int duration = 0;
+        QByteArray diffStat = Console::readCommandOutput(dir, "git diff --stat " + diff, &ok, false, &duration, timeout);
+        if (!ok) {
+            qWarning("error executing git diff %s", qPrintable(diff));
+            ++pendingCount;
+            continue;
+        }
+        QString edgeDiff = Git::parseDiffStat(diffStat);
+        if (!edgeDiff.isEmpty()) {
+            history->edgeDataMap[diff] = edgeDiff;
+            edgeStats->insert(diff, edgeDiff);
+            if (exportWriter)
+                exportWriter->writeEdge(diff, edgeDiff);
+        }
+        if (duration > 10) {
+            qWarning("huge diff: %s [%s]", qPrintable(diff), qPrintable(edgeDiff));
+        }
+    }
+    if (progress)
+        progress->setProgress(progressTo);
+    return pendingCount;
+}
+
+} // namespace Compare
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <QMap>
+#include <QString>
+#include "GitStructure.h"
+
+namespace Export {
+    class Writer;
+}
+
+/**
+  The steps of a comparison that don't depend on the user interface, shared by the window
+  and by the service.
+*/
+namespace Compare {
+
+    /// the timeout of the whole logs (ms): the largest repositories take minutes
+    const int logTimeout = 30 * 60 * 1000;
+
+    /// receives the progress of the long steps, from 0 to 100
+    class Progress {
+    public:
+        virtual ~Progress() {}
+        virtual void setProgress(int value) = 0;
+    };
+
+    /// returns the commit of the revision, or an empty string if it doesn't resolve
+    Git::SHA1 revParse(const QString &dir, const QString &revision);
+
+    /// true if the text is a whole SHA1, in lowercase hex
+    bool isSha1(const QString &text);
+
+    /// true if the descendant contains the ancestor
+    bool isAncestor(const QString &dir, const Git::SHA1 &ancestor, const Git::SHA1 &descendant);
+
+    /// loads the history of the branch at tip, starting from its snapshot if still valid. ok is false
+    /// (and the history empty) if git failed
+    Git::BranchHistory loadHistory(const QString &dir, const QString &branch, const Git::SHA1 &tip, bool *ok = 0);
+
+    /// computes the stats of the edges of the history within the budget (ms, 0 for none, negative if
+    /// already spent), reusing and filling edgeStats, and returns the number of edges left without stats
+    int computeEdgeStats(const QString &dir, Git::BranchHistory *history, QMap<QString, QString> *edgeStats,
+                         int budget, Export::Writer *exportWriter = 0, Progress *progress = 0,
+                         int progressFrom = 0, int progressTo = 100);
+
+} // namespace Compare
+
+#endif // COMPARE_H
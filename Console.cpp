@@ -29,16 +29,11 @@
 #include <QProcess>
 #include <QTime>
 
-QByteArray Console::readCommandOutput(const QString &dir, const QString &cmd, bool *ok, bool readError, int *duration)
+static QByteArray readProcessOutput(QProcess &proc, bool *ok, int *duration, int timeout)
 {
-    QProcess proc;
-    proc.setWorkingDirectory(dir);
-    if (readError)
-        proc.setReadChannelMode(QProcess::MergedChannels);
     QTime timing;
     timing.start();
-    proc.start(cmd);
-    bool finished = proc.waitForFinished(60000);
+    bool finished = proc.waitForFinished(timeout);
     if (duration)
         *duration = qRound((qreal)timing.elapsed() / 1000.0);
     if (!finished && ok) {
@@ -53,3 +48,24 @@ QByteArray Console::readCommandOutput(const QString &dir, const QString &cmd, bo
         *ok = cleanExit;
     return proc.readAll();
 }
+
+QByteArray Console::readCommandOutput(const QString &dir, const QString &cmd, bool *ok, bool readError, int *duration, int timeout)
+{
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    if (readError)
+        proc.setReadChannelMode(QProcess::MergedChannels);
+    proc.start(cmd);
+    return readProcessOutput(proc, ok, duration, timeout);
+}
+
+QByteArray Console::readCommandOutput(const QString &dir, const QString &program, const QStringList &arguments,
+                                      bool *ok, bool readError, int *duration, int timeout)
+{
+    QProcess proc;
+    proc.setWorkingDirectory(dir);
+    if (readError)
+        proc.setReadChannelMode(QProcess::MergedChannels);
+    proc.start(program, arguments);
+    return readProcessOutput(proc, ok, duration, timeout);
+}
@@ -30,12 +30,17 @@
 
 #include <QByteArray>
 #include <QString>
+#include <QStringList>
 
 namespace Console {
 
     /// returns the output of the comman cmd, executed from directory dir, ok will contain the status
     QByteArray readCommandOutput(const QString &dir, const QString &cmd, bool *ok = 0,
-                                 bool readError = false, int *duration = 0);
+                                 bool readError = false, int *duration = 0, int timeout = 60000);
+
+    /// as above, passing the arguments to the program as they are, without splitting them
+    QByteArray readCommandOutput(const QString &dir, const QString &program, const QStringList &arguments,
+                                 bool *ok = 0, bool readError = false, int *duration = 0, int timeout = 60000);
 
 } // namespace Console
 
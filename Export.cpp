@@ -0,0 +1,233 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Export.h"
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+namespace Export {
+
+static const char *kindNames[] = { "primary", "parent", "merge", "unresolved" };
+
+static QString jsonString(const QString &src)
+{
+    QString dst;
+    dst.reserve(src.size() + 2);
+    dst.append('"');
+    foreach (const QChar &c, src) {
+        switch (c.unicode()) {
+        case '"': dst.append("\\\""); break;
+        case '\\': dst.append("\\\\"); break;
+        case '\n': dst.append("\\n"); break;
+        case '\r': dst.append("\\r"); break;
+        case '\t': dst.append("\\t"); break;
+        default:
+            if (c.unicode() < 0x20)
+                dst.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+            else
+                dst.append(c);
+        }
+    }
+    dst.append('"');
+    return dst;
+}
+
+static void writeBinaryString(QDataStream &ds, const QByteArray &utf8)
+{
+    ds << (quint16)utf8.size();
+    ds.writeRawData(utf8.constData(), utf8.size());
+}
+
+static void writeBinarySha1(QDataStream &ds, const Git::SHA1 &sha1)
+{
+    QByteArray raw = QByteArray::fromHex(sha1.toLatin1()).leftJustified(20, '\0', true);
+    ds.writeRawData(raw.constData(), raw.size());
+}
+
+Writer::Writer()
+{
+}
+
+Writer::~Writer()
+{
+    close();
+}
+
+bool Writer::open(const QString &jsonFileName, const QString &binaryFileName)
+{
+    close();
+    if (!jsonFileName.isEmpty()) {
+        mJsonFile.setFileName(jsonFileName);
+        if (!mJsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning("Export::Writer: can't open output file '%s' for writing", qPrintable(jsonFileName));
+            return false;
+        }
+        mJson.setDevice(&mJsonFile);
+        mJson.setCodec("UTF-8");
+    }
+    if (!binaryFileName.isEmpty()) {
+        mBinaryFile.setFileName(binaryFileName);
+        if (!mBinaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning("Export::Writer: can't open output file '%s' for writing", qPrintable(binaryFileName));
+            close();
+            return false;
+        }
+        mBinary.setDevice(&mBinaryFile);
+        mBinary.setByteOrder(QDataStream::LittleEndian);
+        mBinary.writeRawData("VBDX", 4);
+        mBinary << (quint32)1;
+    }
+    return true;
+}
+
+bool Writer::open(QIODevice *jsonDevice)
+{
+    close();
+    if (!jsonDevice->isWritable()) {
+        qWarning("Export::Writer: the output device is not writable");
+        return false;
+    }
+    mJson.setDevice(jsonDevice);
+    mJson.setCodec("UTF-8");
+    return true;
+}
+
+void Writer::writeNodes(const Git::BranchHistory &history)
+{
+    if (mJson.device())
+        mJson << "{\"type\":\"graph\",\"nodes\":" << history.changesFlatList.size() << "}\n";
+
+    const QSet<const Git::Change *> primarySet = history.primaryPathChanges.toSet();
+    foreach (const Git::Change *change, history.changesFlatList) {
+        // the node
+        QString subject = change->subject();
+        if (mJson.device()) {
+            mJson << "{\"type\":\"node\",\"sha\":" << jsonString(change->commitUid)
+                  << ",\"author\":" << jsonString(change->author)
+                  << ",\"timestamp\":" << change->timestamp
+                  << ",\"subject\":" << jsonString(subject);
+            if (!change->body.isEmpty())
+                mJson << ",\"message\":" << jsonString(change->body);
+            mJson << "}\n";
+        }
+        if (mBinary.device()) {
+            QByteArray author = change->author.toUtf8().left(0xFFFF);
+            QByteArray subjectUtf8 = subject.toUtf8().left(0xFFFF);
+            mBinary << (quint8)'N' << (quint32)(20 + 8 + 2 + author.size() + 2 + subjectUtf8.size());
+            writeBinarySha1(mBinary, change->commitUid);
+            mBinary << (qint64)change->timestamp;
+            writeBinaryString(mBinary, author);
+            writeBinaryString(mBinary, subjectUtf8);
+        }
+
+        // its edges, that will be written when their stats are known
+        // the first parent is the first of parentUids: it may be outside of the graph, unlike the merged ones
+        foreach (const Git::Change *parent, change->precedingChanges) {
+            bool firstParent = parent->commitUid == change->parentUids.value(0);
+            Edge edge;
+            edge.from = parent->commitUid;
+            edge.to = change->commitUid;
+            edge.kind = !firstParent ? MergeEdge : primarySet.contains(change) ? PrimaryEdge : ParentEdge;
+            mPendingEdges[parent->diffStringTo(change)] = edge;
+        }
+        foreach (const Git::SHA1 &parentId, change->unresolvedPreceding) {
+            Edge edge;
+            edge.from = parentId;
+            edge.to = change->commitUid;
+            edge.kind = UnresolvedEdge;
+            mPendingEdges[change->diffStringFrom(parentId)] = edge;
+        }
+    }
+    if (mJson.device())
+        mJson.flush();
+    mBinaryFile.flush();
+}
+
+void Writer::writeEdge(const QString &diff, const QString &edgeData)
+{
+    if (!mPendingEdges.contains(diff))
+        return;
+
+    // "=" means no changes, otherwise "+inserts -deletes"
+    int insertions = -1, deletions = -1;
+    if (edgeData == "=") {
+        insertions = deletions = 0;
+    } else {
+        QRegExp stat("\\+(\\d+) -(\\d+)");
+        if (stat.indexIn(edgeData) >= 0) {
+            insertions = stat.cap(1).toInt();
+            deletions = stat.cap(2).toInt();
+        }
+    }
+    writeEdge(mPendingEdges.take(diff), insertions, deletions);
+
+    // let the consumers see the edge right away
+    if (mJson.device())
+        mJson.flush();
+    mBinaryFile.flush();
+}
+
+void Writer::close()
+{
+    foreach (const Edge &edge, mPendingEdges)
+        writeEdge(edge, -1, -1);
+    mPendingEdges.clear();
+    if (mJson.device()) {
+        mJson.flush();
+        mJson.setDevice(0);
+    }
+    mBinary.setDevice(0);
+    mJsonFile.close();
+    mBinaryFile.close();
+}
+
+bool Writer::isOpen() const
+{
+    return mJson.device() || mBinary.device();
+}
+
+void Writer::writeEdge(const Edge &edge, int insertions, int deletions)
+{
+    if (mJson.device()) {
+        mJson << "{\"type\":\"edge\",\"from\":" << jsonString(edge.from) << ",\"to\":" << jsonString(edge.to)
+              << ",\"kind\":\"" << kindNames[edge.kind] << "\"";
+        if (insertions >= 0)
+            mJson << ",\"insertions\":" << insertions << ",\"deletions\":" << deletions << "}\n";
+        else
+            mJson << ",\"insertions\":null,\"deletions\":null}\n";
+    }
+    if (mBinary.device()) {
+        mBinary << (quint8)'E' << (quint32)(20 + 20 + 1 + 4 + 4);
+        writeBinarySha1(mBinary, edge.from);
+        writeBinarySha1(mBinary, edge.to);
+        mBinary << (quint8)edge.kind << (qint32)insertions << (qint32)deletions;
+    }
+}
+
+} // namespace Export
@@ -0,0 +1,98 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <QDataStream>
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QTextStream>
+#include "GitStructure.h"
+
+namespace Export {
+
+    /// kind of an edge, as written in the exports
+    enum EdgeKind {
+        PrimaryEdge = 0,    // first parent, on the primary path
+        ParentEdge = 1,     // first parent, off the primary path
+        MergeEdge = 2,      // any other parent
+        UnresolvedEdge = 3  // parent outside of the graph
+    };
+
+    /**
+      Writes the graph of a BranchHistory while it's computed: nodes first, then every edge as soon
+      as its stats are known. Both formats can be consumed as a stream, one record at a time.
+
+      JSON Lines (.jsonl): one object per line, with "type" set to "graph", "node" or "edge":
+        {"type":"node","sha":..,"author":..,"timestamp":..,"subject":..,"message":..}
+        {"type":"edge","from":..,"to":..,"kind":"primary|parent|merge|unresolved","insertions":..,"deletions":..}
+      the counts are null if unknown, and the message is there only if loaded.
+
+      Binary (.vbd), little endian, made to be memory mapped and scanned:
+        header: "VBDX", u32 version
+        record: u8 tag ('N' or 'E'), u32 payload size, payload
+        'N' payload: sha[20], i64 timestamp, u16 size + author (UTF-8), u16 size + subject (UTF-8)
+        'E' payload: from sha[20], to sha[20], u8 kind, i32 insertions, i32 deletions (-1 if unknown)
+    */
+    class Writer {
+    public:
+        Writer();
+        ~Writer();
+
+        /// opens the outputs, any of the file names can be empty
+        bool open(const QString &jsonFileName, const QString &binaryFileName);
+        /// opens the JSON Lines output on the device, which stays owned by the caller
+        bool open(QIODevice *jsonDevice);
+        /// writes all the nodes, and prepares the edges of the history
+        void writeNodes(const Git::BranchHistory &history);
+        /// writes the edge of the diff, with the stats in the format of Git::parseDiffStat
+        void writeEdge(const QString &diff, const QString &edgeData);
+        /// writes the edges still missing (without stats), and closes the outputs
+        void close();
+        bool isOpen() const;
+
+    private:
+        struct Edge {
+            Git::SHA1 from;
+            Git::SHA1 to;
+            EdgeKind kind;
+        };
+        void writeEdge(const Edge &edge, int insertions, int deletions);
+
+        QFile mJsonFile;
+        QFile mBinaryFile;
+        QTextStream mJson;
+        QDataStream mBinary;
+        QMap<QString, Edge> mPendingEdges;
+    };
+
+} // namespace Export
+
+#endif // EXPORT_H
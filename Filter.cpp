@@ -0,0 +1,225 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Filter.h"
+#include <QDateTime>
+#include <QHash>
+#include <QRegExp>
+#include <QtAlgorithms>
+
+namespace Filter {
+
+//
+// Query
+//
+Query::Query()
+  : since(0), until(0)
+{
+}
+
+bool Query::isEmpty() const
+{
+    return authors.isEmpty() && words.isEmpty() && !since && !until;
+}
+
+Query Query::parse(const QString &text)
+{
+    Query query;
+    foreach (const QString &token, text.split(" ", QString::SkipEmptyParts)) {
+        if (token.startsWith("author:")) {
+            query.authors.append(token.mid(7).toLower());
+        } else if (token.startsWith("since:")) {
+            QDate date = QDate::fromString(token.mid(6), Qt::ISODate);
+            if (date.isValid())
+                query.since = QDateTime(date).toTime_t();
+        } else if (token.startsWith("until:")) {
+            QDate date = QDate::fromString(token.mid(6), Qt::ISODate);
+            if (date.isValid())
+                query.until = QDateTime(date.addDays(1)).toTime_t() - 1;
+        } else {
+            query.words.append(token.toLower());
+        }
+    }
+    return query;
+}
+
+//
+// Index
+//
+static bool earlierThan(const Git::Change *c1, const Git::Change *c2)
+{
+    return c1->timestamp < c2->timestamp;
+}
+
+static QStringList subjectWords(const QString &subject)
+{
+    // keep the dashes, for tickets like ABC-123
+    return subject.toLower().split(QRegExp("[^\\w\\-]+"), QString::SkipEmptyParts);
+}
+
+void Index::build(const Git::BranchHistory &history)
+{
+    clear();
+    foreach (const Git::Change *change, history.changesFlatList) {
+        mChanges.append(change);
+        mAuthors[change->author.toLower()].append(change);
+        foreach (const QString &word, subjectWords(change->subject()).toSet())
+            mWords[word].append(change);
+    }
+    mTimeline = mChanges;
+    qStableSort(mTimeline.begin(), mTimeline.end(), earlierThan);
+}
+
+void Index::clear()
+{
+    mChanges.clear();
+    mAuthors.clear();
+    mWords.clear();
+    mTimeline.clear();
+}
+
+QSet<const Git::Change *> Index::match(const Query &query) const
+{
+    QList<QSet<const Git::Change *> > sets;
+
+    // any of the authors (there are way less authors than changes)
+    if (!query.authors.isEmpty()) {
+        QSet<const Git::Change *> set;
+        QMap<QString, QList<const Git::Change *> >::const_iterator it;
+        for (it = mAuthors.constBegin(); it != mAuthors.constEnd(); ++it) {
+            foreach (const QString &author, query.authors) {
+                if (it.key().contains(author)) {
+                    set.unite(it.value().toSet());
+                    break;
+                }
+            }
+        }
+        sets.append(set);
+    }
+
+    // all the words, each one being the beginning of any word
+    foreach (const QString &word, query.words) {
+        QSet<const Git::Change *> set;
+        QMap<QString, QList<const Git::Change *> >::const_iterator it = mWords.lowerBound(word);
+        for (; it != mWords.constEnd() && it.key().startsWith(word); ++it)
+            set.unite(it.value().toSet());
+        sets.append(set);
+    }
+
+    // the range of dates
+    if (query.since || query.until) {
+        Git::Change bound;
+        const Git::Change *boundPtr = &bound;
+        bound.timestamp = query.since;
+        QList<const Git::Change *>::const_iterator begin = qLowerBound(mTimeline.constBegin(), mTimeline.constEnd(), boundPtr, earlierThan);
+        bound.timestamp = query.until ? query.until : Q_INT64_C(0x7FFFFFFFFFFFFFFF);
+        QList<const Git::Change *>::const_iterator end = qUpperBound(begin, mTimeline.constEnd(), boundPtr, earlierThan);
+        QSet<const Git::Change *> set;
+        for (; begin != end; ++begin)
+            set.insert(*begin);
+        sets.append(set);
+    }
+
+    // intersect, starting from the smallest
+    if (sets.isEmpty())
+        return mChanges.toSet();
+    int smallest = 0;
+    for (int i = 1; i < sets.size(); ++i)
+        if (sets[i].size() < sets[smallest].size())
+            smallest = i;
+    QSet<const Git::Change *> result = sets.takeAt(smallest);
+    foreach (const QSet<const Git::Change *> &set, sets)
+        result.intersect(set);
+    return result;
+}
+
+//
+// filterHistory
+//
+typedef QHash<const Git::Change *, QList<Git::SHA1> > NearestMap;
+
+static void appendUnique(QList<Git::SHA1> *ids, const Git::SHA1 &id)
+{
+    if (!ids->contains(id))
+        ids->append(id);
+}
+
+// returns the nearest kept ancestors of the change, in the order of its parents
+static QList<Git::SHA1> nearestKept(const Git::Change *start, const Git::BranchHistory &history,
+                                    const QSet<const Git::Change *> &kept, NearestMap *nearest)
+{
+    // depth first without recursion, parents are resolved before their children
+    QList<const Git::Change *> stack;
+    stack.append(start);
+    while (!stack.isEmpty()) {
+        const Git::Change *change = stack.last();
+        if (nearest->contains(change)) {
+            stack.removeLast();
+            continue;
+        }
+        bool ready = true;
+        foreach (const Git::Change *parent, change->precedingChanges) {
+            if (!kept.contains(parent) && !nearest->contains(parent)) {
+                stack.append(parent);
+                ready = false;
+            }
+        }
+        if (!ready)
+            continue;
+
+        // kept and unresolved parents stay, the others are replaced by their own nearest
+        QList<Git::SHA1> ids;
+        foreach (const Git::SHA1 &id, change->parentUids) {
+            const Git::Change *parent = history.idChangeMap.value(id);
+            if (!parent || kept.contains(parent))
+                appendUnique(&ids, id);
+            else
+                foreach (const Git::SHA1 &nearestId, nearest->value(parent))
+                    appendUnique(&ids, nearestId);
+        }
+        nearest->insert(change, ids);
+        stack.removeLast();
+    }
+    return nearest->value(start);
+}
+
+Git::BranchHistory filterHistory(const Git::BranchHistory &history, const QSet<const Git::Change *> &kept)
+{
+    NearestMap nearest;
+    QList<Git::Change *> changes;
+    foreach (const Git::Change *hChange, history.changesFlatList) {
+        if (!kept.contains(hChange))
+            continue;
+        Git::Change *change = new Git::Change(hChange);
+        change->parentUids = nearestKept(hChange, history, kept, &nearest);
+        changes.append(change);
+    }
+    return Git::buildHistory(changes);
+}
+
+} // namespace Filter
@@ -0,0 +1,75 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "GitStructure.h"
+
+namespace Filter {
+
+    /// what to keep of a history: a change must match all the conditions
+    struct Query {
+        QStringList authors; // parts of the author name or e-mail, any of them
+        QStringList words;   // beginnings of words of the subject, all of them
+        qint64 since;        // [if not 0] oldest timestamp
+        qint64 until;        // [if not 0] newest timestamp
+
+        Query();
+        bool isEmpty() const;
+        /// parses "author:<name> since:<yyyy-mm-dd> until:<yyyy-mm-dd> <word>..."
+        static Query parse(const QString &text);
+    };
+
+    /// index of the authors, of the subject words and of the dates of a history
+    class Index {
+    public:
+        /// indexes the changes of the history, which must stay alive while the index is used
+        void build(const Git::BranchHistory &history);
+        void clear();
+        /// returns the changes matching the query
+        QSet<const Git::Change *> match(const Query &query) const;
+
+    private:
+        QList<const Git::Change *> mChanges;
+        QMap<QString, QList<const Git::Change *> > mAuthors;
+        QMap<QString, QList<const Git::Change *> > mWords; // sorted, to look up the words by their beginning
+        QList<const Git::Change *> mTimeline;              // sorted by timestamp
+    };
+
+    /// keeps only the given changes, linking each of them to its nearest kept ancestors
+    Git::BranchHistory filterHistory(const Git::BranchHistory &history, const QSet<const Git::Change *> &kept);
+
+} // namespace Filter
+
+#endif // FILTER_H
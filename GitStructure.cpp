@@ -27,20 +27,24 @@
 
 #include "GitStructure.h"
 #include <QTextStream>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
+#include <QtConcurrentMap>
 
 namespace Git {
 //
 // Change
 //
 Change::Change()
-  //: nextChange(0)
+  : timestamp(0)//, nextChange(0)
 {
 }
 
 Change::Change(const Change *p)
   : commitUid(p->commitUid), shortUid(p->shortUid), author(p->author)
-  , date(p->date), message(p->message)//, nextChange(0)
+  , timestamp(p->timestamp), message(p->message), body(p->body)//, nextChange(0)
+  , parentUids(p->parentUids)
 {
 }
 
@@ -63,6 +67,12 @@ QString Change::diffStringFrom(const QString &sha1) const
     return QString("%1...%2").arg(sha1.left(8)).arg(shortUid);
 }
 
+QString Change::subject() const
+{
+    // the message is the subject only, the whole message is in the body
+    return message.simplified();
+}
+
 
 //
 // MergedHistory
@@ -82,6 +92,43 @@ QStringList BranchHistory::allEdgeDiffs(bool includeUnresolved) const
     return edgeDiffs;
 }
 
+QStringList BranchHistory::scheduledEdgeDiffs() const
+{
+    QStringList primaryDiffs, sideDiffs, unresolvedDiffs, unresolvedMergeDiffs;
+    QSet<const Git::Change *> primarySet = primaryPathChanges.toSet();
+    foreach (const Git::Change *change, changesFlatList) {
+        // the first parent of the primary path is the one that matters the most, even if unresolved
+        bool onPrimaryPath = primarySet.contains(change);
+        const Git::SHA1 firstParentUid = change->parentUids.value(0);
+        foreach (const Git::Change *parentChange, change->precedingChanges) {
+            bool primaryEdge = onPrimaryPath && parentChange->commitUid == firstParentUid;
+            (primaryEdge ? primaryDiffs : sideDiffs).append(parentChange->diffStringTo(change));
+        }
+        // unresolved diffs may span a whole branch, and merges are the largest of them
+        bool isMerge = change->parentUids.size() > 1;
+        foreach (const Git::SHA1 &parentChange, change->unresolvedPreceding) {
+            if (onPrimaryPath && parentChange == firstParentUid)
+                primaryDiffs.append(change->diffStringFrom(parentChange));
+            else
+                (isMerge ? unresolvedMergeDiffs : unresolvedDiffs).append(change->diffStringFrom(parentChange));
+        }
+    }
+    return primaryDiffs + sideDiffs + unresolvedDiffs + unresolvedMergeDiffs;
+}
+
+void BranchHistory::clear()
+{
+    qDeleteAll(idChangeMap);
+    lastChange = 0;
+    changesFlatList.clear();
+    idChangeMap.clear();
+    firstChanges.clear();
+    primaryPathChanges.clear();
+    edgeDataMap.clear();
+    unresolvedMap.clear();
+    mergeSummaryMap.clear();
+}
+
 BranchHistory::BranchHistory()
   : lastChange(0)
 {
@@ -90,119 +137,193 @@ BranchHistory::BranchHistory()
 //
 // Utility functions
 //
-struct PostResolveMerge {
-    Git::Change *owner;
-    QList<Git::SHA1> parentIds;
-};
-typedef QList<PostResolveMerge> PostResolveMerges;
-
-static void createLinks(const Git::PostResolveMerges &relations, Git::BranchHistory *history) {
-    foreach (const Git::PostResolveMerge &prm, relations) {
-        Git::Change *commit = prm.owner;
-        foreach (const Git::SHA1 id, prm.parentIds) {
-            if (!history->idChangeMap.contains(id)) {
-                commit->unresolvedPreceding.append(id);
+struct LinkParents {
+    LinkParents(const QMap<Git::SHA1, Git::Change *> &map) : idChangeMap(map) {}
+    // only touches the change itself, so that all the changes can be linked in parallel
+    void operator()(Git::Change *change) const {
+        change->precedingChanges.clear();
+        change->unresolvedPreceding.clear();
+        foreach (const Git::SHA1 &id, change->parentUids) {
+            Git::Change *parent = idChangeMap.value(id);
+            if (!parent) {
+                change->unresolvedPreceding.append(id);
                 //qWarning("createLinks: could not locate %s for merge", qPrintable(id.left(7)));
                 continue;
             }
-            Git::Change *parent = history->idChangeMap[id];
-            parent->setNextChange(commit);
-            history->firstChanges.removeAll(commit);
+            parent->setNextChange(change);
         }
     }
+    const QMap<Git::SHA1, Git::Change *> &idChangeMap;
+};
+
+static void createLinks(QList<Git::Change *> changes, Git::BranchHistory *history) {
+    QtConcurrent::blockingMap(changes, LinkParents(history->idChangeMap));
+
+    // the index of the unresolved, and the first changes, which are the ones left without parents
+    history->firstChanges.clear();
+    foreach (Git::Change *change, changes) {
+        foreach (const Git::SHA1 &id, change->unresolvedPreceding)
+            history->unresolvedMap.insert(id, change);
+        if (change->precedingChanges.isEmpty())
+            history->firstChanges.append(change);
+    }
+}
+
+static void relinkChange(Git::Change *change, Git::BranchHistory *history)
+{
+    // rebuild the parents in the original order, now that some of them may be known
+    bool wasFirst = change->precedingChanges.isEmpty();
+    foreach (const Git::SHA1 &id, change->unresolvedPreceding)
+        history->unresolvedMap.remove(id, change);
+    change->precedingChanges.clear();
+    change->unresolvedPreceding.clear();
+    foreach (const Git::SHA1 &id, change->parentUids) {
+        Git::Change *parent = history->idChangeMap.value(id);
+        if (parent) {
+            parent->setNextChange(change);
+        } else {
+            change->unresolvedPreceding.append(id);
+            history->unresolvedMap.insert(id, change);
+        }
+    }
+    if (wasFirst && !change->precedingChanges.isEmpty())
+        history->firstChanges.removeAll(change);
+    else if (!wasFirst && change->precedingChanges.isEmpty())
+        history->firstChanges.append(change);
+}
+
+static Git::Change *firstParent(const Git::Change *change)
+{
+    // the first parent may be outside of the history, and then a merged side would come first
+    if (change->parentUids.isEmpty())
+        return 0;
+    foreach (Git::Change *parent, change->precedingChanges)
+        if (parent->commitUid == change->parentUids.first())
+            return parent;
+    return 0;
+}
+
+static void extendPrimaryPath(Git::BranchHistory *history)
+{
+    // continue descending from the last known element of the primary path
+    if (history->primaryPathChanges.isEmpty())
+        return;
+    const Git::Change *change = firstParent(history->primaryPathChanges.last());
+    while (change) {
+        history->primaryPathChanges.append(change);
+        change = firstParent(change);
+    }
 }
 
 static void buildPrimaryPath(Git::BranchHistory *history)
 {
-    // build the primary path by descending through the first branch on every merge node
+    // build the primary path by descending through the first parent on every merge node
     history->primaryPathChanges.clear();
-    if (!history->lastChange)
-        return;
     Git::Change *change = history->lastChange;
     while (change) {
         history->primaryPathChanges.append(change);
-        if (change->precedingChanges.isEmpty())
-            break;
-        change = change->precedingChanges.first();
+        change = firstParent(change);
     }
 }
 
-Git::BranchHistory parseLogToHistory(const QByteArray &log)
+QString logCommand(const QString &revisions)
 {
-    /* Example commit
-      commit 7a4d3c3a5889a3486eeb8d9bd61d64d669712b78 fc3566dd8afb671f5f2629103dc98fc790e21a90 5d642ece04e802dcbaa12629f75de3ea292e8444
-      Merge: fc3566d 5d642ec
-      Author: Cary Clark <cary@android.com>
-      Date:   Thu Apr 22 06:51:03 2010 -0700
-    */
-    Git::BranchHistory history;
+    return "git log -z \"--format=%H%n%P%n%an <%ae>%n%at%n%s\" " + revisions;
+}
 
-    Git::PostResolveMerges resolveRelations;
-    QTextStream ts(log);
-    while (!ts.atEnd()) {
-        // sync to a start
-        QString line = ts.readLine();
-        if (!line.startsWith("commit "))
+static QList<Git::Change *> parseLogShard(const QByteArray &log)
+{
+    /* Example commit, terminated by a NUL
+      7a4d3c3a5889a3486eeb8d9bd61d64d669712b78
+      fc3566dd8afb671f5f2629103dc98fc790e21a90 5d642ece04e802dcbaa12629f75de3ea292e8444
+      Cary Clark <cary@android.com>
+      1271944263
+      Merge branch 'froyo' into gingerbread
+    */
+    QList<Git::Change *> changes;
+    int pos = 0;
+    while (pos < log.size()) {
+        int end = log.indexOf('\0', pos);
+        if (end < 0)
+            end = log.size();
+        while (pos < end && log[pos] == '\n')
+            ++pos;
+        if (pos == end) {
+            pos = end + 1;
             continue;
+        }
 
-        // create the MergeItem and add it to the History
-        nextCommit:
+        // one field per line: hash, parents, author, timestamp and subject
+        QList<QByteArray> fields = QByteArray::fromRawData(log.constData() + pos, end - pos).split('\n');
+        pos = end + 1;
+        if (fields.size() < 5) {
+            qWarning("parseLogToHistory: expected 5 fields, found %d. ignoring.", fields.size());
+            continue;
+        }
         Git::Change *change = new Git::Change;
-        QStringList ids = line.mid(7).split(" ", QString::SkipEmptyParts);
-        change->commitUid = ids.takeFirst();
+        change->commitUid = QString::fromLatin1(fields[0]);
         change->shortUid = change->commitUid.left(8);
+        change->parentUids = QString::fromLatin1(fields[1]).split(" ", QString::SkipEmptyParts);
+        change->author = QString::fromUtf8(fields[2]);
+        change->timestamp = fields[3].toLongLong();
+        change->message = QString::fromUtf8(fields[4]);
+        changes.append(change);
+    }
 
-        history.idChangeMap[change->commitUid] = change;
-        history.changesFlatList.append(change);
-        history.firstChanges.append(change);
-        if (!history.lastChange)
-            history.lastChange = change;
-
-        // post parent-child resolutions
-        if (!ids.isEmpty()) {
-            Git::PostResolveMerge resolve;
-            resolve.owner = change;
-            foreach (const Git::SHA1 &id, ids)
-                resolve.parentIds.append(id);
-            resolveRelations.append(resolve);
-        }
+    return changes;
+}
 
-        // parse log contents
-        bool readingMessage = false;
-        while (!ts.atEnd()) {
-            line = ts.readLine();
-            if (readingMessage) {
-                if (line.startsWith("commit "))
-                    break;
-                change->message.append(line + "\n");
-                continue;
-            }
-            if (line.startsWith("Author: ")) {
-                change->author = line.mid(8);
-                continue;
-            }
-            if (line.startsWith("Date: ")) {
-                change->date = line.mid(6);
-                if (!ts.atEnd()) {
-                    if (!ts.readLine().isEmpty())
-                        qWarning("parseLogToHistory: expected blank. ignoring.");
-                }
-                readingMessage = true;
-                continue;
-            }
-            if (line.startsWith("Merge: ")) {
-                //QStringList branches = line.mid(7).split(" ", QString::SkipEmptyParts);
-                continue;
-            }
-        }
+Git::BranchHistory parseLogToHistory(const QByteArray &log)
+{
+    // split the log in shards, at the end of commits
+    static const int minShardSize = 1 << 20;
+    int shardsCount = qBound(1, log.size() / minShardSize, 4 * QThread::idealThreadCount());
+    QList<QByteArray> shards;
+    int start = 0;
+    for (int i = 1; i < shardsCount && start < log.size(); ++i) {
+        int end = log.indexOf('\0', qMax(start, (int)((qint64)log.size() * i / shardsCount)));
+        if (end < 0)
+            break;
+        shards.append(QByteArray::fromRawData(log.constData() + start, end + 1 - start));
+        start = end + 1;
+    }
+    shards.append(QByteArray::fromRawData(log.constData() + start, log.size() - start));
+
+    // parse them in parallel, and merge them in order
+    QList<QList<Git::Change *> > shardChanges = QtConcurrent::blockingMapped<QList<QList<Git::Change *> > >(shards, parseLogShard);
+    QList<Git::Change *> changes;
+    foreach (const QList<Git::Change *> &shard, shardChanges)
+        changes += shard;
+    return buildHistory(changes);
+}
 
-        // start parsing the next commit (TODO, make this cleaner)
-        if (!ts.atEnd())
-            goto nextCommit;
+QByteArray formatLog(const Git::BranchHistory &history)
+{
+    QByteArray log;
+    foreach (const Git::Change *change, history.changesFlatList) {
+        log += change->commitUid.toLatin1() + '\n';
+        log += QStringList(change->parentUids).join(" ").toLatin1() + '\n';
+        log += change->author.toUtf8() + '\n';
+        log += QByteArray::number(change->timestamp) + '\n';
+        log += change->message.toUtf8();
+        log += '\0';
+    }
+    return log;
+}
+
+Git::BranchHistory buildHistory(const QList<Git::Change *> &changes)
+{
+    Git::BranchHistory history;
+
+    foreach (Git::Change *change, changes) {
+        history.idChangeMap[change->commitUid] = change;
+        history.changesFlatList.append(change);
     }
+    if (!changes.isEmpty())
+        history.lastChange = changes.first();
 
     // post-resolution
-    createLinks(resolveRelations, &history);
+    createLinks(changes, &history);
 
     // build the primary path
     buildPrimaryPath(&history);
@@ -210,42 +331,281 @@ Git::BranchHistory parseLogToHistory(const QByteArray &log)
     return history;
 }
 
+QString messagesCommand(const QList<Git::SHA1> &ids)
+{
+    return "git show -s -z --format=%H%n%B " + QStringList(ids).join(" ");
+}
+
+void parseMessages(const QByteArray &log, Git::BranchHistory *history)
+{
+    foreach (const QByteArray &record, log.split('\0')) {
+        // the hash, and the whole message after it
+        int split = record.indexOf('\n');
+        if (split < 0)
+            continue;
+        Git::Change *change = history->idChangeMap.value(QString::fromLatin1(record.left(split).trimmed()));
+        if (change)
+            change->body = QString::fromUtf8(record.mid(split + 1)).trimmed();
+    }
+}
+
+// adopts the new changes of the page, before or after the existing ones
+static void mergeHistory(Git::BranchHistory *history, Git::BranchHistory *page, bool newer)
+{
+    // adopt the changes that are not known yet
+    QList<Git::Change *> adopted;
+    QSet<Git::SHA1> duplicates;
+    foreach (const Git::Change *pageChange, page->changesFlatList) {
+        Git::Change *change = page->idChangeMap.value(pageChange->commitUid);
+        if (history->idChangeMap.contains(change->commitUid)) {
+            duplicates.insert(change->commitUid);
+            delete change;
+            continue;
+        }
+        history->idChangeMap[change->commitUid] = change;
+        if (change->precedingChanges.isEmpty())
+            history->firstChanges.append(change);
+        adopted.append(change);
+    }
+    if (newer) {
+        QList<const Git::Change *> changes;
+        foreach (const Git::Change *change, adopted)
+            changes.append(change);
+        history->changesFlatList = changes + history->changesFlatList;
+        if (!adopted.isEmpty())
+            history->lastChange = adopted.first();
+    } else {
+        foreach (const Git::Change *change, adopted)
+            history->changesFlatList.append(change);
+        if (!history->lastChange && !adopted.isEmpty())
+            history->lastChange = adopted.first();
+    }
+
+    // the page doesn't own the changes anymore
+    page->idChangeMap.clear();
+    page->clear();
+
+    // relink the adopted changes on the boundary, and all the changes that were waiting for them
+    QSet<Git::Change *> relinks;
+    foreach (Git::Change *change, adopted) {
+        foreach (Git::Change *waiting, history->unresolvedMap.values(change->commitUid))
+            relinks.insert(waiting);
+        if (!change->unresolvedPreceding.isEmpty())
+            relinks.insert(change);
+        else
+            foreach (const Git::SHA1 &id, change->parentUids)
+                if (duplicates.contains(id))
+                    relinks.insert(change);
+    }
+    foreach (Git::Change *change, relinks)
+        relinkChange(change, history);
+
+    // a new head changes the whole primary path, an older page may only make it go deeper
+    if (newer || history->primaryPathChanges.isEmpty())
+        buildPrimaryPath(history);
+    else
+        extendPrimaryPath(history);
+}
+
+void appendHistory(Git::BranchHistory *history, Git::BranchHistory *page)
+{
+    mergeHistory(history, page, false);
+}
+
+void prependHistory(Git::BranchHistory *history, Git::BranchHistory *page)
+{
+    mergeHistory(history, page, true);
+}
+
+void removeChanges(Git::BranchHistory *history, const QList<Git::SHA1> &ids)
+{
+    // take the changes out of the index
+    QSet<const Git::Change *> removed;
+    foreach (const Git::SHA1 &id, ids) {
+        Git::Change *change = history->idChangeMap.take(id);
+        if (!change)
+            continue;
+        foreach (const Git::SHA1 &parentId, change->unresolvedPreceding)
+            history->unresolvedMap.remove(parentId, change);
+        removed.insert(change);
+    }
+    if (removed.isEmpty())
+        return;
+
+    // find the children of the removed changes
+    QList<Git::Change *> orphans;
+    foreach (Git::Change *change, history->idChangeMap) {
+        foreach (const Git::Change *parent, change->precedingChanges) {
+            if (removed.contains(parent)) {
+                orphans.append(change);
+                break;
+            }
+        }
+    }
+
+    // rebuild the lists without them
+    QList<const Git::Change *> changes;
+    foreach (const Git::Change *change, history->changesFlatList)
+        if (!removed.contains(change))
+            changes.append(change);
+    history->changesFlatList = changes;
+    changes.clear();
+    foreach (const Git::Change *change, history->firstChanges)
+        if (!removed.contains(change))
+            changes.append(change);
+    history->firstChanges = changes;
+    if (removed.contains(history->lastChange))
+        history->lastChange = history->changesFlatList.isEmpty() ? 0 : history->idChangeMap.value(history->changesFlatList.first()->commitUid);
+
+    // the children now point to unresolved parents
+    foreach (Git::Change *change, orphans)
+        relinkChange(change, history);
+    buildPrimaryPath(history);
+
+    foreach (const Git::Change *change, removed)
+        delete change;
+}
+
+// copies into a new history all the changes picked by the selector, relinking them
+template <typename Selector>
+static Git::BranchHistory selectHistory(const Git::BranchHistory &hSource, const Selector &isSelected)
+{
+    // duplicate the selected Change nodes
+    QList<Git::Change *> changes;
+    foreach (const Git::Change *cA, hSource.changesFlatList)
+        if (isSelected(cA))
+            changes.append(new Git::Change(cA));
+
+    return buildHistory(changes);
+}
+
+struct NotInHistory {
+    NotInHistory(const Git::BranchHistory &h) : history(h) {}
+    bool operator()(const Git::Change *change) const {
+        return !history.idChangeMap.contains(change->commitUid);
+    }
+    const Git::BranchHistory &history;
+};
+
+struct ReachableOnlyFrom {
+    ReachableOnlyFrom(int a, int b) : branchA(a), branchB(b) {}
+    bool operator()(const Git::Change *change) const {
+        const QBitArray &bits = change->reachability;
+        if (branchA >= bits.size() || !bits.testBit(branchA))
+            return false;
+        return branchB >= bits.size() || !bits.testBit(branchB);
+    }
+    int branchA, branchB;
+};
+
 // result = A - B;
 Git::BranchHistory deltaHistory(const Git::BranchHistory &hA, const Git::BranchHistory &hB)
 {
-    Git::BranchHistory history;
-
-    QList<Git::PostResolveMerge> resolveRelations;
-    foreach (const Git::Change *cA, hA.changesFlatList) {
-        Git::SHA1 id = cA->commitUid;
+    return selectHistory(hA, NotInHistory(hB));
+}
 
-        // skip change if present on the B history
-        if (hB.idChangeMap.contains(id))
+Git::BranchHistory summariseHistory(const Git::BranchHistory &history)
+{
+    // from the oldest merge on: what an older merge brought in is not brought in by the newer ones
+    QSet<const Git::Change *> visited;
+    foreach (const Git::Change *change, history.primaryPathChanges)
+        visited.insert(change);
+    QMap<Git::SHA1, Git::MergeSummary> summaries;
+    for (int i = history.primaryPathChanges.size() - 1; i >= 0; --i) {
+        const Git::Change *merge = history.primaryPathChanges[i];
+        if (merge->parentUids.size() < 2)
             continue;
+        Git::MergeSummary summary;
+        QList<const Git::Change *> stack;
+        foreach (const Git::Change *parent, merge->precedingChanges)
+            if (parent->commitUid != merge->parentUids.first())
+                stack.append(parent);
+        while (!stack.isEmpty()) {
+            const Git::Change *change = stack.takeLast();
+            if (visited.contains(change))
+                continue;
+            visited.insert(change);
+            ++summary.changesCount;
+            if (!summary.authors.contains(change->author))
+                summary.authors.append(change->author);
+            foreach (const Git::Change *parent, change->precedingChanges)
+                stack.append(parent);
+        }
+        summaries[merge->commitUid] = summary;
+    }
 
-        // duplicate the Change node
-        Git::Change *change = new Git::Change(cA);
-        history.idChangeMap[change->commitUid] = change;
-        history.firstChanges.append(change);
-        history.changesFlatList.append(change);
-        if (!history.lastChange)
-            history.lastChange = change;
-
-        // add resolution link
-        Git::PostResolveMerge resolve;
-        resolve.owner = change;
-        foreach (const Git::Change *parent, cA->precedingChanges)
-            resolve.parentIds.append(parent->commitUid);
-        resolveRelations.append(resolve);
+    // the primary path, linked by the first parents only
+    QList<Git::Change *> changes;
+    for (int i = 0; i < history.primaryPathChanges.size(); ++i) {
+        const Git::Change *pChange = history.primaryPathChanges[i];
+        Git::Change *change = new Git::Change(pChange);
+        if (i + 1 < history.primaryPathChanges.size())
+            change->parentUids = QList<Git::SHA1>() << history.primaryPathChanges[i + 1]->commitUid;
+        else
+            change->parentUids = pChange->parentUids.mid(0, 1);
+        changes.append(change);
     }
+    Git::BranchHistory summarised = buildHistory(changes);
+    summarised.mergeSummaryMap = summaries;
+    return summarised;
+}
 
-    // post-resolution
-    createLinks(resolveRelations, &history);
+void computeReachability(Git::BranchHistory *hUnion, const QList<Git::SHA1> &tips)
+{
+    // reset the bits and mark the tips
+    foreach (Git::Change *change, hUnion->idChangeMap)
+        change->reachability = QBitArray(tips.size());
+    for (int i = 0; i < tips.size(); ++i) {
+        Git::Change *tip = hUnion->idChangeMap.value(tips[i]);
+        if (!tip) {
+            qWarning("computeReachability: can't find tip %s", qPrintable(tips[i].left(8)));
+            continue;
+        }
+        tip->reachability.setBit(i);
+    }
 
-    // build the primary path
-    buildPrimaryPath(&history);
+    // children always come before their parents, so a single pass propagates all the bits
+    foreach (const Git::Change *change, hUnion->changesFlatList)
+        foreach (Git::Change *parent, change->precedingChanges)
+            parent->reachability |= change->reachability;
+}
 
-    return history;
+Git::BranchHistory deltaHistory(const Git::BranchHistory &hUnion, int branchA, int branchB)
+{
+    return selectHistory(hUnion, ReachableOnlyFrom(branchA, branchB));
+}
+
+QVector<int> exclusiveCounts(const Git::BranchHistory &hUnion, int branchCount)
+{
+    // straight from the bits: the changes contained by one branch only
+    QVector<int> counts(branchCount, 0);
+    foreach (const Git::Change *change, hUnion.changesFlatList) {
+        const QBitArray &bits = change->reachability;
+        if (bits.size() < branchCount || bits.count(true) != 1)
+            continue;
+        for (int a = 0; a < branchCount; ++a)
+            if (bits.testBit(a))
+                ++counts[a];
+    }
+    return counts;
+}
+
+QVector<QVector<int> > deltaMatrix(const Git::BranchHistory &hUnion, int branchCount)
+{
+    QVector<QVector<int> > matrix(branchCount, QVector<int>(branchCount, 0));
+    foreach (const Git::Change *change, hUnion.changesFlatList) {
+        const QBitArray &bits = change->reachability;
+        if (bits.size() < branchCount)
+            continue;
+        for (int a = 0; a < branchCount; ++a) {
+            if (!bits.testBit(a))
+                continue;
+            for (int b = 0; b < branchCount; ++b)
+                if (!bits.testBit(b))
+                    ++matrix[a][b];
+        }
+    }
+    return matrix;
 }
 
 QString parseDiffStat(const QByteArray &log)
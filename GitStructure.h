@@ -30,8 +30,12 @@
 
 #include <QString>
 #include <QMap>
+#include <QMultiHash>
 #include <QList>
 #include <QByteArray>
+#include <QStringList>
+#include <QBitArray>
+#include <QVector>
 
 namespace Git {
 
@@ -43,16 +47,21 @@ namespace Git {
         Git::SHA1 commitUid;
         QString shortUid;
         QString author;
-        QString date;
-        QString message;
+        qint64 timestamp; // seconds since the epoch
+        QString message; // the subject only
+        QString body; // [if not empty] the whole message, loaded on demand
 
         // relations
         //Change *nextChange; // NULL only if root of the current tree
         QList<Change *> precedingChanges; // NULL only if the first commit of a branch
+        QList<Git::SHA1> parentUids; // all the parents, in the original order
 
         // temporary
         QList<Git::SHA1> unresolvedPreceding; // not empty only on incomplete subgraphs
 
+        // [if not empty] bit N is set if the N-th compared branch contains this change
+        QBitArray reachability;
+
         // default constructor
         Change();
         // copy constructor
@@ -63,6 +72,15 @@ namespace Git {
         QString diffStringTo(const Change *next) const;
         // return "yr_sha1...my_sha1"
         QString diffStringFrom(const QString &sha1) const;
+        // return the subject, without extra whitespace
+        QString subject() const;
+    };
+
+    /// the changes brought in by a merge of the primary path
+    struct MergeSummary {
+        int changesCount;
+        QStringList authors;
+        MergeSummary() : changesCount(0) {}
     };
 
     ///
@@ -80,16 +98,65 @@ namespace Git {
         // [if not empty] the diffs for each edge
         QMap<QString, QString> edgeDataMap;
 
+        // [if not empty] the changes waiting for each of the unresolved parents
+        QMultiHash<Git::SHA1, Git::Change *> unresolvedMap;
+
+        // [if not empty] what each change of a summarised history stands for
+        QMap<Git::SHA1, Git::MergeSummary> mergeSummaryMap;
+
         QStringList allEdgeDiffs(bool includeUnresolved) const;
+        // all the edge diffs, by priority: primary path, side edges, unresolved edges, unresolved merges
+        QStringList scheduledEdgeDiffs() const;
+        // deletes all the changes (only for the history that owns them)
+        void clear();
         BranchHistory();
     };
 
-    /// parses the output of "git log --parents" to create a flow of commits
+    /// returns the command that logs the given revisions in the format understood by parseLogToHistory
+    QString logCommand(const QString &revisions);
+
+    /// parses the output of logCommand to create a flow of commits
     Git::BranchHistory parseLogToHistory(const QByteArray &log);
 
+    /// writes the changes of the history in the format of logCommand, for parseLogToHistory
+    QByteArray formatLog(const Git::BranchHistory &history);
+
+    /// returns the command that shows the whole messages of the changes, for parseMessages
+    QString messagesCommand(const QList<Git::SHA1> &ids);
+
+    /// parses the output of messagesCommand, to set the body of the changes of the history
+    void parseMessages(const QByteArray &log, Git::BranchHistory *history);
+
+    /// links the changes (in log order, children first) into a new history that owns them
+    Git::BranchHistory buildHistory(const QList<Git::Change *> &changes);
+
+    /// adds an older page of changes to the history, resolving the boundary of both (page is emptied)
+    void appendHistory(Git::BranchHistory *history, Git::BranchHistory *page);
+
+    /// adds the newer changes on top of the history, which will have a new head (page is emptied)
+    void prependHistory(Git::BranchHistory *history, Git::BranchHistory *page);
+
+    /// removes the changes from the history, their children will have unresolved parents
+    void removeChanges(Git::BranchHistory *history, const QList<Git::SHA1> &ids);
+
     /// subtracts B from A to find out what changed in the history
     Git::BranchHistory deltaHistory(const Git::BranchHistory &hA, const Git::BranchHistory &hB);
 
+    /// marks on every change which of the tips can reach it (hUnion must be in --topo-order)
+    void computeReachability(Git::BranchHistory *hUnion, const QList<Git::SHA1> &tips);
+
+    /// subtracts branch B from branch A, using the reachability bits of the union history
+    Git::BranchHistory deltaHistory(const Git::BranchHistory &hUnion, int branchA, int branchB);
+
+    /// keeps only the primary path, with every merge summarising the changes it brought in
+    Git::BranchHistory summariseHistory(const Git::BranchHistory &history);
+
+    /// counts the changes contained in each branch only, and in no other branch
+    QVector<int> exclusiveCounts(const Git::BranchHistory &hUnion, int branchCount);
+
+    /// counts the changes of the (A - B) delta for every pair of branches (A = row, B = column)
+    QVector<QVector<int> > deltaMatrix(const Git::BranchHistory &hUnion, int branchCount);
+
     /// parses the output of "git diff --stat" and builds a string with insertions and deletions
     QString parseDiffStat(const QByteArray &log);
 
@@ -28,20 +28,60 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include "GitStructure.h"
+#include "Compare.h"
 #include "Console.h"
+#include "Filter.h"
+#include "Render.h"
+#include "Service.h"
 #include <QColorDialog>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
 #include <QDesktopServices>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QProcess>
+#include <QSet>
 #include <QSettings>
 #include <QTextStream>
 #include <QTemporaryFile>
+#include <QTextDocument>
+#include <QTime>
+#include <QTimer>
 #include <QUrl>
 
+// marks the window busy for the scope of a run, and schedules the refs changes held back meanwhile
+class BusyScope {
+public:
+    BusyScope(int *busyCount, bool *refsPending, QTimer *refsTimer)
+      : mBusyCount(busyCount), mRefsPending(refsPending), mRefsTimer(refsTimer)
+    {
+        ++*mBusyCount;
+    }
+    ~BusyScope()
+    {
+        if (--*mBusyCount == 0 && *mRefsPending) {
+            *mRefsPending = false;
+            mRefsTimer->start();
+        }
+    }
+private:
+    int *mBusyCount;
+    bool *mRefsPending;
+    QTimer *mRefsTimer;
+};
+
 MainWindow::MainWindow(QWidget *parent)
   : QMainWindow(parent)
   , ui(new Ui::MainWindow)
+  , mRefsWatcher(new QFileSystemWatcher(this))
+  , mRefsTimer(new QTimer(this))
+  , mIndexDirty(true)
+  , mWindowed(false)
+  , mBusyCount(0)
+  , mRefsPending(false)
 {
     ui->setupUi(this);
     connect(ui->runButton, SIGNAL(clicked()), this, SLOT(slotRunClicked()));
@@ -49,6 +89,16 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->branch1Color, SIGNAL(clicked()), this, SLOT(slotPickColor()));
     connect(ui->branch2Color, SIGNAL(clicked()), this, SLOT(slotPickColor()));
     connect(ui->locationEdit, SIGNAL(textChanged(QString)), this, SLOT(populateBranchBoxes()));
+    connect(ui->moreButton, SIGNAL(clicked()), this, SLOT(slotMoreClicked()));
+    connect(ui->watchBox, SIGNAL(toggled(bool)), this, SLOT(watchRefs()));
+    connect(ui->filterEdit, SIGNAL(returnPressed()), this, SLOT(slotFilterChanged()));
+
+    // git touches many refs files at once, so wait for it to settle
+    mRefsTimer->setSingleShot(true);
+    mRefsTimer->setInterval(500);
+    connect(mRefsWatcher, SIGNAL(directoryChanged(QString)), mRefsTimer, SLOT(start()));
+    connect(mRefsWatcher, SIGNAL(fileChanged(QString)), mRefsTimer, SLOT(start()));
+    connect(mRefsTimer, SIGNAL(timeout()), this, SLOT(slotRefsChanged()));
 
     QSettings s;
     if (s.contains("General/LastPath"))
@@ -66,6 +116,7 @@ MainWindow::~MainWindow()
 {
     QSettings s;
     s.setValue("General/LastPath", ui->locationEdit->text());
+    mDelta.clear();
     delete ui;
 }
 
@@ -104,6 +155,15 @@ void MainWindow::setProgress(int value)
 
 void MainWindow::populateBranchBoxes()
 {
+    // edge stats are only valid within the same repository
+    mEdgeStats.clear();
+    mIndex.clear();
+    mDelta.clear();
+    mDeltaDir.clear();
+    mWindowed = false;
+    ui->moreButton->setEnabled(false);
+    watchRefs();
+
     ui->branch1Combo->clear();
     ui->branch2Combo->clear();
     QStringList branches = QString(Console::readCommandOutput(ui->locationEdit->text(), "git branch -a")).split("\n");
@@ -166,7 +226,7 @@ namespace Dot {
 
     static void writeGraphFile(const Git::BranchHistory &history, const QString &mainLabel,
                                const QColor &color, const QColor &refColor, bool writeOnEdges,
-                               const QString &outFileName)
+                               bool markPending, const QString &outFileName)
     {
         // open the text stream
         QFile file(outFileName);
@@ -210,7 +270,7 @@ namespace Dot {
         QStringList nodesMap;
         foreach (const Git::Change *item, history.changesFlatList) {
             // create label text
-            QString label = item->message.split("\n", QString::SkipEmptyParts).first().simplified();
+            QString label = item->subject();
             label.replace("\"", "'");
             int i = 67;
             while (i < label.length()) {
@@ -219,6 +279,17 @@ namespace Dot {
             }
             //label.replace(". ", ".\\n ");
 
+            // what a summarised merge stands for
+            if (history.mergeSummaryMap.contains(item->commitUid)) {
+                const Git::MergeSummary &summary = history.mergeSummaryMap[item->commitUid];
+                QStringList authors;
+                foreach (const QString &author, summary.authors.mid(0, 3))
+                    authors.append(author.section(" <", 0, 0).replace("\"", "'"));
+                if (summary.authors.size() > 3)
+                    authors.append(QString("%1 more").arg(summary.authors.size() - 3));
+                label += QString("\\n[%1 changes by %2]").arg(summary.changesCount).arg(authors.join(", "));
+            }
+
             // add the node
             bool isMerge = (item->precedingChanges.size() + item->unresolvedPreceding.size()) > 1;
             QString attributes = "label=\"" + label + "\"";
@@ -240,10 +311,11 @@ namespace Dot {
 
         // edges
         ts << "    // edges" << "\n";
+        QSet<const Git::Change *> primarySet = history.primaryPathChanges.toSet();
         foreach (const Git::Change *change, history.changesFlatList) {
             // normal edges
             bool mergeLine = false;
-            bool primaryItem = history.primaryPathChanges.contains(change);
+            bool primaryItem = primarySet.contains(change);
             foreach (const Git::Change *precChange, change->precedingChanges) {
                 QString edgeAttribs;
                 if (!mergeLine && primaryItem)
@@ -255,6 +327,8 @@ namespace Dot {
                     label = precChange->diffStringTo(change);
                     if (history.edgeDataMap.contains(label))
                         label += "  (" + history.edgeDataMap[label] + ")";
+                    else if (markPending)
+                        label += "  (pending)";
                 }
                 writeEdge(ts, precChange->shortUid, change->shortUid, label, edgeAttribs);
                 mergeLine = true;
@@ -267,6 +341,8 @@ namespace Dot {
                     label = change->diffStringFrom(precUnresolved);
                     if (history.edgeDataMap.contains(label))
                         label += "  (" + history.edgeDataMap[label] + ")";
+                    else if (markPending)
+                        label += "  (pending)";
                 }
                 writeEdge(ts, precUnresolved.left(8), change->shortUid, label, "style=dotted, color=" + lineColorRef);
             }
@@ -280,10 +356,12 @@ namespace Dot {
 
 void MainWindow::slotRunClicked()
 {
+    BusyScope busy(&mBusyCount, &mRefsPending, mRefsTimer);
     QString dir = ui->locationEdit->text();
     QString b1 = ui->branch1Combo->currentText();
     QString b2 = ui->branch2Combo->currentText();
     bool b1Off = !ui->branch1Combo->currentIndex();
+    ui->moreButton->setEnabled(false);
 
     // verify branches
     QString branches = Console::readCommandOutput(dir, "git branch -a");
@@ -295,83 +373,502 @@ void MainWindow::slotRunClicked()
         ui->statusBar->showMessage("B2 ERROR");
         return;
     }
+
+    // compare all against all, if more branches are specified
+    QStringList moreBranches = ui->branchesEdit->text().split(" ", QString::SkipEmptyParts);
+    if (!moreBranches.isEmpty()) {
+        foreach (const QString &branch, moreBranches) {
+            if (!branches.contains(branch)) {
+                ui->statusBar->showMessage(tr("Unknown branch '%1'").arg(branch));
+                return;
+            }
+        }
+        if (!b1Off)
+            moreBranches.prepend(b1);
+        moreBranches.insert(b1Off ? 0 : 1, b2);
+        mIndex.clear();
+        mDelta.clear();
+        mDeltaDir.clear();
+        watchRefs();
+        runMatrix(dir, moreBranches);
+        return;
+    }
+
+    runDelta(dir, b1Off ? QString() : b1, b2);
+}
+
+void MainWindow::runDelta(const QString &dir, const QString &b1, const QString &b2)
+{
+    // start from the current tips, to be able to follow them later
+    bool b1Off = b1.isEmpty();
+    Git::SHA1 tip1 = b1Off ? QString() : Compare::revParse(dir, b1);
+    Git::SHA1 tip2 = Compare::revParse(dir, b2);
+    if ((!b1Off && tip1.isEmpty()) || tip2.isEmpty()) {
+        ui->statusBar->showMessage(tr("Cannot resolve the tips of %1 and %2").arg(b1).arg(b2));
+        return;
+    }
+    mDelta.clear();
+    mIndex.clear();
+    mIndexDirty = true;
+    mDeltaDir = dir;
+    mDeltaB1 = b1Off ? tr("The big bang") : b1;
+    mDeltaB2 = b2;
+    mTip1 = tip1;
+    mTip2 = tip2;
+    mWindowed = false;
+    mImageFileName.clear();
+    mExportBaseName.clear();
+
+    // load the delta one window at a time, if limited
+    if (ui->windowSpin->value() > 0 || !ui->sinceEdit->text().isEmpty() || !ui->untilEdit->text().isEmpty()) {
+        runWindow();
+        return;
+    }
     setProgress(0);
 
+    // the service keeps the histories and the edge stats warm, if running
+    if (ui->serviceBox->isChecked()) {
+        bool stats = ui->showEdgeDiff->isChecked() && ui->showEdgeWeight->isChecked();
+        quint16 port = QSettings().value("Service/Port", Service::defaultPort).toUInt();
+        if (Service::fetchDelta(port, dir, b1, b2, stats, ui->budgetSpin->value(), &mDelta, this, 0, 30)) {
+            QMap<QString, QString>::const_iterator it = mDelta.edgeDataMap.constBegin();
+            for (; it != mDelta.edgeDataMap.constEnd(); ++it)
+                mEdgeStats.insert(it.key(), it.value());
+            setProgress(30);
+            showDelta(30);
+            watchRefs();
+            return;
+        }
+        qWarning("the service didn't answer on port %d, comparing here", port);
+    }
+
     // get all the commits in branch 1
     Git::BranchHistory hist1;
+    bool ok = true;
     if (!b1Off) {
-        QByteArray commits1 = Console::readCommandOutput(dir, "git log --parents " + b1);
-         setProgress(5);
-         hist1 = Git::parseLogToHistory(commits1);
+        hist1 = Compare::loadHistory(dir, b1, tip1, &ok);
          setProgress(10);
     }
 
     // get all the commits in branch 2
-    QByteArray commits2 = Console::readCommandOutput(dir, "git log --parents " + b2);
-     setProgress(15);
-    Git::BranchHistory hist2 = Git::parseLogToHistory(commits2);
+    Git::BranchHistory hist2;
+    if (ok)
+        hist2 = Compare::loadHistory(dir, b2, tip2, &ok);
+    if (!ok) {
+        hist1.clear();
+        ui->statusBar->showMessage(tr("Cannot read the log of %1 and %2").arg(b1).arg(b2));
+        setProgress(-1);
+        return;
+    }
      setProgress(20);
 
     // delta = 2 - 1
-    Git::BranchHistory histDelta = Git::deltaHistory(hist2, hist1);
+    mDelta = Git::deltaHistory(hist2, hist1);
+    mIndexDirty = true;
+    hist1.clear();
+    hist2.clear();
      setProgress(30);
 
-    // get all the diffs from the changes in the delta
-    if (ui->showEdgeDiff->isChecked() && ui->showEdgeWeight->isChecked()) {
-        QStringList edgesDiffs = histDelta.allEdgeDiffs(true);
-        int edgeDiffsCount = edgesDiffs.size(), edgeDiffsIdx = 0;
-        foreach (const QString &diff, edgesDiffs) {
-            setProgress(30 + (50 * edgeDiffsIdx++) / edgeDiffsCount);
-            bool ok = false;
-            int duration = 0;
-            QByteArray diffStat = Console::readCommandOutput(dir, "git diff --stat " + diff, &ok, false, &duration);
-            if (!ok) {
-                qWarning("error executing git diff %s", qPrintable(diff));
+    showDelta(30);
+    watchRefs();
+}
+
+void MainWindow::runWindow()
+{
+    // ask git for the delta directly, limited in size and dates
+    QString options;
+    if (!ui->sinceEdit->text().isEmpty())
+        options += "--since=\"" + ui->sinceEdit->text() + "\" ";
+    if (!ui->untilEdit->text().isEmpty())
+        options += "--until=\"" + ui->untilEdit->text() + "\" ";
+    mWindowOptions = options;
+    mWindowed = true;
+    slotMoreClicked();
+    watchRefs();
+}
+
+void MainWindow::slotMoreClicked()
+{
+    if (!mWindowed)
+        return;
+    BusyScope busy(&mBusyCount, &mRefsPending, mRefsTimer);
+    setProgress(0);
+    ui->moreButton->setEnabled(false);
+
+    // load the next page, and merge it with the previous ones
+    int windowSize = ui->windowSpin->value();
+    QString pageOptions;
+    if (windowSize > 0)
+        pageOptions = QString("--skip=%1 -n %2 ").arg(mDelta.changesFlatList.size()).arg(windowSize);
+    // from the tips of the delta, not from the branches: the pages must not shift when they move
+    QString revisions = mWindowOptions + mTip2;
+    if (!mTip1.isEmpty())
+        revisions += " ^" + mTip1;
+    bool ok = false;
+    QByteArray commits = Console::readCommandOutput(mDeltaDir, Git::logCommand(pageOptions + revisions), &ok,
+                                                    false, 0, Compare::logTimeout);
+    if (!ok) {
+        // the same page can be asked again
+        ui->statusBar->showMessage(tr("Cannot read the next %1 changes of %2").arg(windowSize).arg(mDeltaB2));
+        ui->moreButton->setEnabled(true);
+        setProgress(-1);
+        return;
+    }
+     setProgress(10);
+    Git::BranchHistory page = Git::parseLogToHistory(commits);
+    int pageSize = page.changesFlatList.size();
+    Git::appendHistory(&mDelta, &page);
+    mIndexDirty = true;
+     setProgress(20);
+
+    showDelta(20);
+    ui->moreButton->setEnabled(windowSize > 0 && pageSize == windowSize);
+}
+
+void MainWindow::showDelta(int progressFrom)
+{
+    // only the matching changes, if filtered
+    Git::BranchHistory filtered;
+    Git::BranchHistory *shown = &mDelta;
+    Filter::Query query = Filter::Query::parse(ui->filterEdit->text());
+    if (!query.isEmpty()) {
+        if (mIndexDirty) {
+            mIndex.build(mDelta);
+            mIndexDirty = false;
+        }
+        filtered = Filter::filterHistory(mDelta, mIndex.match(query));
+        shown = &filtered;
+    }
+
+    // only the primary path, with one diff per merge, if summarised
+    Git::BranchHistory summary;
+    if (ui->summaryBox->isChecked()) {
+        summary = Git::summariseHistory(*shown);
+        shown = &summary;
+    }
+
+    // stream the graph out while the stats are computed
+    if (ui->exportBox->isChecked()) {
+        if (mExportBaseName.isEmpty())
+            mExportBaseName = QDir::tempPath() + "/delta_" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+        if (mExport.open(mExportBaseName + ".jsonl", mExportBaseName + ".vbd")) {
+            loadMessages(mDeltaDir, shown);
+            mExport.writeNodes(*shown);
+        }
+    }
+
+    // only the edges without stats will be computed
+    int pendingCount = 0;
+    if (ui->showEdgeDiff->isChecked() && ui->showEdgeWeight->isChecked())
+        pendingCount = computeEdgeStats(mDeltaDir, shown, &mEdgeStats, progressFrom, 80);
+    bool exported = mExport.isOpen();
+    mExport.close();
+
+    // updates overwrite the same file, so that viewers can reload it
+    bool update = !mImageFileName.isEmpty();
+    QString label = tr("<<B>Graph of changes between</B>:<BR/><I>%1</I>, and<BR/><I>%2</I><BR/>(%3 new nodes)>")
+            .arg(mDeltaB1).arg(mDeltaB2).arg(mDelta.changesFlatList.size());
+    QString imgFileName = renderGraph(*shown, label, mColor2, mColor1, update ? mImageFileName.section('.', 0, -2) : QString());
+    int shownCount = shown->changesFlatList.size();
+    filtered.clear();
+    summary.clear();
+    if (imgFileName.isEmpty()) {
+        setProgress(100);
+        return;
+    }
+    mImageFileName = imgFileName;
+     setProgress(95);
+
+    QString message = tr("%1 file '%2' with %3 changes").arg(update ? tr("Updated") : tr("Created"))
+            .arg(imgFileName).arg(mDelta.idChangeMap.size());
+    if (shownCount != mDelta.changesFlatList.size())
+        message += tr(" (%1 shown)").arg(shownCount);
+    if (pendingCount)
+        message += tr(", %1 edges pending (run again to complete)").arg(pendingCount);
+    if (exported)
+        message += tr(", data in '%1.jsonl/.vbd'").arg(mExportBaseName);
+    ui->statusBar->showMessage(message);
+
+    if (!update)
+        QDesktopServices::openUrl(QUrl(imgFileName));
+    setProgress(100);
+}
+
+void MainWindow::slotFilterChanged()
+{
+    // the delta is already there, only filter it again
+    if (mDeltaDir.isEmpty())
+        return;
+    BusyScope busy(&mBusyCount, &mRefsPending, mRefsTimer);
+    setProgress(0);
+    showDelta(0);
+}
+
+void MainWindow::loadMessages(const QString &dir, Git::BranchHistory *history)
+{
+    // the log only has the subjects, ask git for the whole messages in batches
+    static const int batchSize = 200;
+    QList<Git::SHA1> ids;
+    foreach (const Git::Change *change, history->changesFlatList) {
+        if (change->body.isEmpty())
+            ids.append(change->commitUid);
+        if (ids.size() == batchSize || (!ids.isEmpty() && change == history->changesFlatList.last())) {
+            Git::parseMessages(Console::readCommandOutput(dir, Git::messagesCommand(ids)), history);
+            ids.clear();
+        }
+    }
+}
+
+void MainWindow::watchRefs()
+{
+    // forget the previous paths, the refs folders may have changed
+    QStringList paths = mRefsWatcher->directories() + mRefsWatcher->files();
+    if (!paths.isEmpty())
+        mRefsWatcher->removePaths(paths);
+    if (!ui->watchBox->isChecked() || mDeltaDir.isEmpty())
+        return;
+
+    // watch every folder of refs (loose refs are replaced by renaming), and the packed refs
+    QString gitDir = QString(Console::readCommandOutput(mDeltaDir, "git rev-parse --git-dir")).trimmed();
+    if (gitDir.isEmpty())
+        return;
+    gitDir = QDir(mDeltaDir).absoluteFilePath(gitDir);
+    paths.clear();
+    paths.append(gitDir + "/refs");
+    QDirIterator it(gitDir + "/refs", QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        paths.append(it.next());
+    if (QFile::exists(gitDir + "/packed-refs"))
+        paths.append(gitDir + "/packed-refs");
+    mRefsWatcher->addPaths(paths);
+}
+
+void MainWindow::slotRefsChanged()
+{
+    if (mDeltaDir.isEmpty() || !ui->watchBox->isChecked())
+        return;
+
+    // setProgress lets the timer fire within a run: check again when it's over
+    if (mBusyCount) {
+        mRefsPending = true;
+        return;
+    }
+    BusyScope busy(&mBusyCount, &mRefsPending, mRefsTimer);
+
+    // find out which branches moved
+    Git::SHA1 tip1 = mTip1.isEmpty() ? QString() : Compare::revParse(mDeltaDir, mDeltaB1);
+    Git::SHA1 tip2 = Compare::revParse(mDeltaDir, mDeltaB2);
+    watchRefs();
+    if (tip2.isEmpty() || (tip1 == mTip1 && tip2 == mTip2))
+        return;
+
+    // rewritten branches need a full run, of the branches on screen
+    if ((tip1 != mTip1 && !Compare::isAncestor(mDeltaDir, mTip1, tip1)) || (tip2 != mTip2 && !Compare::isAncestor(mDeltaDir, mTip2, tip2))) {
+        runDelta(mDeltaDir, mTip1.isEmpty() ? QString() : mDeltaB1, mDeltaB2);
+        return;
+    }
+    setProgress(0);
+
+    // read both sides first: if git fails, the delta and the tips stay as they are
+    bool ok = true;
+    QByteArray merged, commits;
+    if (tip1 != mTip1)
+        merged = Console::readCommandOutput(mDeltaDir, "git rev-list " + tip1 + " ^" + mTip1, &ok,
+                                            false, 0, Compare::logTimeout);
+    if (ok && tip2 != mTip2) {
+        QString revisions = tip2 + " ^" + mTip2;
+        if (!tip1.isEmpty())
+            revisions += " ^" + tip1;
+        commits = Console::readCommandOutput(mDeltaDir, Git::logCommand(revisions), &ok, false, 0, Compare::logTimeout);
+    }
+    if (!ok) {
+        // a full run of the branches on screen doesn't depend on the missed changes
+        qWarning("cannot read the changes of the branches, running again");
+        runDelta(mDeltaDir, mTip1.isEmpty() ? QString() : mDeltaB1, mDeltaB2);
+        return;
+    }
+     setProgress(10);
+
+    // the changes that reached branch 1 are not part of the delta anymore
+    if (tip1 != mTip1) {
+        QList<Git::SHA1> ids;
+        foreach (const QString &id, QString(merged).split("\n", QString::SkipEmptyParts))
+            ids.append(id.trimmed());
+        Git::removeChanges(&mDelta, ids);
+    }
+
+    // the new changes of branch 2 go on top
+    if (tip2 != mTip2) {
+        Git::BranchHistory page = Git::parseLogToHistory(commits);
+        Git::prependHistory(&mDelta, &page);
+    }
+     setProgress(20);
+
+    mTip1 = tip1;
+    mTip2 = tip2;
+    mIndexDirty = true;
+    showDelta(20);
+}
+
+void MainWindow::runMatrix(const QString &dir, const QStringList &branches)
+{
+    setProgress(0);
+
+    // resolve the tips of all the branches
+    QStringList tips;
+    foreach (const QString &branch, branches) {
+        Git::SHA1 tip = Compare::revParse(dir, branch);
+        if (tip.isEmpty()) {
+            ui->statusBar->showMessage(tr("Cannot resolve the tip of %1").arg(branch));
+            setProgress(-1);
+            return;
+        }
+        tips.append(tip);
+    }
+
+    // load the union of all the histories at once, and find out which branches contain every change
+    bool ok = false;
+    QByteArray commits = Console::readCommandOutput(dir, Git::logCommand("--topo-order " + tips.join(" ")), &ok,
+                                                    false, 0, Compare::logTimeout);
+    if (!ok) {
+        ui->statusBar->showMessage(tr("Cannot read the log of %1").arg(branches.join(", ")));
+        setProgress(-1);
+        return;
+    }
+     setProgress(10);
+    Git::BranchHistory histUnion = Git::parseLogToHistory(commits);
+     setProgress(20);
+    Git::computeReachability(&histUnion, tips);
+    QVector<QVector<int> > matrix = Git::deltaMatrix(histUnion, branches.size());
+    QVector<int> exclusive = Git::exclusiveCounts(histUnion, branches.size());
+    int unionSize = histUnion.changesFlatList.size();
+     setProgress(25);
+
+    // pick the output folder
+    QString outDir = QDir::tempPath() + "/branch-matrix_" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+    if (!QDir().mkpath(outDir)) {
+        histUnion.clear();
+        ui->statusBar->showMessage(tr("Cannot create folder '%1'").arg(outDir));
+        setProgress(-1);
+        return;
+    }
+
+    // one graph per pair, sharing the edge stats and the time budget between pairs
+    int count = branches.size(), pairIdx = 0, pendingCount = 0;
+    int budget = ui->budgetSpin->value() * 1000;
+    QTime timing;
+    timing.start();
+    QMap<QString, QString> pairFiles;
+    for (int a = 0; a < count; ++a) {
+        for (int b = 0; b < count; ++b) {
+            if (a == b)
                 continue;
+            int progress = 25 + (70 * pairIdx++) / (count * (count - 1));
+            setProgress(progress);
+            if (!matrix[a][b])
+                continue;
+            Git::BranchHistory histDelta = Git::deltaHistory(histUnion, a, b);
+            if (ui->showEdgeDiff->isChecked() && ui->showEdgeWeight->isChecked()) {
+                // after the deadline, only the stats already known are used
+                int remaining = 0;
+                if (budget > 0)
+                    remaining = budget > timing.elapsed() ? budget - timing.elapsed() : -1;
+                pendingCount += Compare::computeEdgeStats(dir, &histDelta, &mEdgeStats, remaining, &mExport, this,
+                                                          progress, progress);
             }
-            QString edgeDiff = Git::parseDiffStat(diffStat);
-            if (!edgeDiff.isEmpty())
-                histDelta.edgeDataMap[diff] = edgeDiff;
-            if (duration > 10) {
-                qWarning("huge diff: %s [%s]", qPrintable(diff), qPrintable(edgeDiff));
-            }
+            QString label = tr("<<B>Graph of changes between</B>:<BR/><I>%1</I>, and<BR/><I>%2</I><BR/>(%3 new nodes)>")
+                    .arg(Qt::escape(branches[b])).arg(Qt::escape(branches[a])).arg(histDelta.changesFlatList.size());
+            QString imgFileName = renderGraph(histDelta, label, mColor2, mColor1,
+                                              QString("%1/delta_%2_%3").arg(outDir).arg(a).arg(b));
+            if (!imgFileName.isEmpty())
+                pairFiles[QString("%1_%2").arg(a).arg(b)] = QFileInfo(imgFileName).fileName();
+            histDelta.clear();
         }
-        setProgress(80);
     }
+    histUnion.clear();
+
+    // the report: A - B on every cell, and the changes that only A contains
+    QString reportFileName = outDir + "/index.html";
+    QFile reportFile(reportFileName);
+    if (!reportFile.open(QIODevice::WriteOnly)) {
+        ui->statusBar->showMessage(tr("Cannot write '%1'").arg(reportFileName));
+        setProgress(-1);
+        return;
+    }
+    QTextStream ts(&reportFile);
+    ts << "<html><head><title>Branch matrix</title></head><body>" << "\n";
+    ts << "<p>Changes contained in the branch of the row, and not in the branch of the column (" << unionSize << " changes in total).</p>" << "\n";
+    ts << "<table border=\"1\" cellpadding=\"4\"><tr><th></th>";
+    foreach (const QString &branch, branches)
+        ts << "<th>" << Qt::escape(branch) << "</th>";
+    ts << "<th>only here</th></tr>" << "\n";
+    for (int a = 0; a < count; ++a) {
+        ts << "<tr><th>" << Qt::escape(branches[a]) << "</th>";
+        for (int b = 0; b < count; ++b) {
+            QString key = QString("%1_%2").arg(a).arg(b);
+            if (a == b)
+                ts << "<td>-</td>";
+            else if (pairFiles.contains(key))
+                ts << "<td><a href=\"" << pairFiles[key] << "\">" << matrix[a][b] << "</a></td>";
+            else
+                ts << "<td>" << matrix[a][b] << "</td>";
+        }
+        ts << "<td>" << exclusive[a] << "</td></tr>" << "\n";
+    }
+    ts << "</table>" << "\n";
+    if (pendingCount)
+        ts << "<p>" << pendingCount << " edges are still without stats: the time budget ran out (run again to complete).</p>" << "\n";
+    ts << "</body></html>" << "\n";
+    reportFile.close();
+
+    QString message = tr("Created report '%1' for %2 branches").arg(reportFileName).arg(count);
+    if (pendingCount)
+        message += tr(", %1 edges pending (run again to complete)").arg(pendingCount);
+    ui->statusBar->showMessage(message);
+    QDesktopServices::openUrl(QUrl::fromLocalFile(reportFileName));
+    setProgress(100);
+}
 
+int MainWindow::computeEdgeStats(const QString &dir, Git::BranchHistory *history, QMap<QString, QString> *edgeStats,
+                                 int progressFrom, int progressTo)
+{
+    return Compare::computeEdgeStats(dir, history, edgeStats, ui->budgetSpin->value() * 1000, &mExport, this,
+                                     progressFrom, progressTo);
+}
+
+QString MainWindow::renderGraph(const Git::BranchHistory &history, const QString &label, const QColor &color,
+                                const QColor &refColor, const QString &outBaseName)
+{
     QTemporaryFile dotFileDummy("graph_XXXXXX.dot");
     dotFileDummy.open();
     QString dotFileName = dotFileDummy.fileName();
     dotFileDummy.close();
 
-    QString label = tr("<<B>Graph of changes between</B>:<BR/><I>%1</I>, and<BR/><I>%2</I><BR/>(%3 new nodes)>")
-            .arg(b1).arg(b2).arg(histDelta.changesFlatList.size());
-    Dot::writeGraphFile(histDelta, label, mColor2, mColor1,
-                        ui->showEdgeDiff->isChecked(), dotFileName);
-     setProgress(85);
+    Dot::writeGraphFile(history, label, color, refColor, ui->showEdgeDiff->isChecked(),
+                        ui->showEdgeDiff->isChecked() && ui->showEdgeWeight->isChecked(), dotFileName);
 
     QString dotType, imgExt;
     switch (ui->typesBox->currentIndex()) {
     case 0: dotType = "png"; imgExt = "png"; break;
     case 1: dotType = "svg"; imgExt = "svg"; break;
     case 2: dotType = "pdf"; imgExt = "pdf"; break;
+    case 3: dotType = "tiles"; imgExt = "html"; break;
     }
 
-    QTemporaryFile imgFileDummy("graph_XXXXXX." + imgExt);
-    imgFileDummy.open();
-    QString imgFileName = QDir::tempPath() + "/" + imgFileDummy.fileName();
-    imgFileDummy.close();
+    QString imgFileName = outBaseName + "." + imgExt;
+    if (outBaseName.isEmpty()) {
+        QTemporaryFile imgFileDummy("graph_XXXXXX." + imgExt);
+        imgFileDummy.open();
+        imgFileName = QDir::tempPath() + "/" + imgFileDummy.fileName();
+        imgFileDummy.close();
+    }
 
-    QString genCommand = "dot -T" + dotType + " -Grankdir=BT -s0.5 -o" + imgFileName + " " + dotFileName;
-    if (QProcess::execute(genCommand) < 0) {
+    QString genCommand;
+    bool rendered = dotType == "tiles" ? Render::renderDotTiles(dotFileName, imgFileName, &genCommand)
+                                       : Render::renderDotFile(dotFileName, dotType, imgFileName, &genCommand);
+    if (!rendered) {
         ui->statusBar->showMessage(tr("Cannot Execute '%1'").arg(genCommand));
-        setProgress(100);
-        return;
+        return QString();
     }
-     setProgress(95);
-
-    ui->statusBar->showMessage(tr("Created file '%1' with %2 changes").arg(imgFileName).arg(histDelta.idChangeMap.size()));
-
-    QDesktopServices::openUrl(QUrl(imgFileName));
-    setProgress(100);
+    return imgFileName;
 }
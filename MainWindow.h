@@ -30,13 +30,21 @@
 
 #include <QMainWindow>
 #include <QColor>
+#include <QMap>
+#include <QStringList>
+#include "Compare.h"
+#include "Export.h"
+#include "Filter.h"
+#include "GitStructure.h"
 class MyProcess;
+class QFileSystemWatcher;
+class QTimer;
 
 namespace Ui {
     class MainWindow;
 }
 
-class MainWindow : public QMainWindow
+class MainWindow : public QMainWindow, private Compare::Progress
 {
     Q_OBJECT
 
@@ -47,15 +55,51 @@ public:
 private:
     void setColor(int idx /*0, 1*/, const QColor &color);
     void setProgress(int value);
+    void runDelta(const QString &dir, const QString &b1, const QString &b2);
+    void runWindow();
+    void showDelta(int progressFrom);
+    void loadMessages(const QString &dir, Git::BranchHistory *history);
+    void runMatrix(const QString &dir, const QStringList &branches);
+    int computeEdgeStats(const QString &dir, Git::BranchHistory *history, QMap<QString, QString> *edgeStats,
+                         int progressFrom, int progressTo);
+    QString renderGraph(const Git::BranchHistory &history, const QString &label, const QColor &color,
+                        const QColor &refColor, const QString &outBaseName = QString());
     Ui::MainWindow *ui;
     QColor mColor1;
     QColor mColor2;
+    QMap<QString, QString> mEdgeStats;
+
+    QFileSystemWatcher *mRefsWatcher;
+    QTimer *mRefsTimer;
+
+    // the delta on screen, kept for loading more pages and for following the branches
+    Git::BranchHistory mDelta;
+    QString mDeltaDir;
+    QString mDeltaB1;
+    QString mDeltaB2;
+    Git::SHA1 mTip1;
+    Git::SHA1 mTip2;
+    QString mWindowOptions;
+    QString mImageFileName;
+    QString mExportBaseName;
+    Export::Writer mExport;
+    Filter::Index mIndex;
+    bool mIndexDirty;
+    bool mWindowed;
+
+    // runs in progress (setProgress processes events), and refs changes held back meanwhile
+    int mBusyCount;
+    bool mRefsPending;
 
 private slots:
     void populateBranchBoxes();
     void slotPickColor();
     void slotPickLocation();
     void slotRunClicked();
+    void slotMoreClicked();
+    void watchRefs();
+    void slotRefsChanged();
+    void slotFilterChanged();
 };
 
 #endif // MAINWINDOW_H
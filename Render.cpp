@@ -0,0 +1,371 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Render.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMap>
+#include <QProcess>
+#include <QRegExp>
+#include <QTextStream>
+#include <QUrl>
+#include <QtConcurrentMap>
+#include <qmath.h>
+
+namespace Render {
+
+static const char *layoutOptions = "-Grankdir=BT -s0.5";
+
+// pans with the mouse and zooms with the wheel, loading only the visible tiles of the level
+static const char *viewerScript =
+        "var view = document.getElementById('view'), level = 0, left = 0, upper = 0, shown = {}, drag = null;\n"
+        "function draw() {\n"
+        "  var w = levels[level][0], h = levels[level][1], keep = {};\n"
+        "  for (var ty = Math.max(0, Math.floor(-upper / size)); ty * size < h && ty * size + upper < view.clientHeight; ++ty)\n"
+        "    for (var tx = Math.max(0, Math.floor(-left / size)); tx * size < w && tx * size + left < view.clientWidth; ++tx) {\n"
+        "      var key = level + '/' + tx + '_' + ty, img = shown[key];\n"
+        "      if (!img) { img = document.createElement('img'); img.src = tiles + '/' + key + '.png'; view.appendChild(img); }\n"
+        "      img.style.left = (left + tx * size) + 'px'; img.style.top = (upper + ty * size) + 'px';\n"
+        "      keep[key] = img;\n"
+        "    }\n"
+        "  for (var key in shown) if (!keep[key]) view.removeChild(shown[key]);\n"
+        "  shown = keep;\n"
+        "}\n"
+        "function zoom(delta, x, y) {\n"
+        "  var next = Math.min(levels.length - 1, Math.max(0, level + delta)), f = Math.pow(2, next - level);\n"
+        "  left = x - (x - left) * f; upper = y - (y - upper) * f; level = next; draw();\n"
+        "}\n"
+        "view.onwheel = function(e) { e.preventDefault(); zoom(e.deltaY < 0 ? 1 : -1, e.clientX, e.clientY); };\n"
+        "view.ondblclick = function(e) { zoom(1, e.clientX, e.clientY); };\n"
+        "view.onmousedown = function(e) { e.preventDefault(); drag = [e.clientX - left, e.clientY - upper]; };\n"
+        "window.onmousemove = function(e) { if (drag) { left = e.clientX - drag[0]; upper = e.clientY - drag[1]; draw(); } };\n"
+        "window.onmouseup = function() { drag = null; };\n"
+        "window.onresize = draw;\n"
+        "draw();\n";
+
+// runs the command, writing to a temporary file that replaces fileName only when complete
+static bool execute(const QString &command, const QString &fileName, QString *failedCommand)
+{
+    QString tmpFileName = fileName + ".tmp";
+    QString fullCommand = command.arg(tmpFileName);
+    if (QProcess::execute(fullCommand) != 0 || !QFile::exists(tmpFileName)) {
+        if (failedCommand)
+            *failedCommand = fullCommand;
+        QFile::remove(tmpFileName);
+        return false;
+    }
+    QFile::remove(fileName);
+    return QFile::rename(tmpFileName, fileName);
+}
+
+QString cacheDir()
+{
+    return QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/renders";
+}
+
+// the size of the renders folder, beyond which the least recently used graphs are removed
+static const qint64 maxCacheSize = Q_INT64_C(1024) * 1024 * 1024;
+
+// updates the modification time, which orders the graphs of the cache by their last use
+static void touch(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite))
+        return;
+    char c;
+    if (file.getChar(&c) && file.seek(0))
+        file.putChar(c);
+}
+
+static qint64 treeSize(const QString &path)
+{
+    qint64 size = 0;
+    foreach (const QFileInfo &info, QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot))
+        size += info.isDir() ? treeSize(info.filePath()) : info.size();
+    return size;
+}
+
+static void removeTree(const QString &path)
+{
+    foreach (const QFileInfo &info, QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (info.isDir())
+            removeTree(info.filePath());
+        else
+            QFile::remove(info.filePath());
+    }
+    QDir().rmdir(path);
+}
+
+// removes the least recently used graphs (layout, outputs and tiles) beyond the size of the cache
+static void pruneCache(const QString &layoutFileName)
+{
+    QString keptKey = QFileInfo(layoutFileName).fileName().section('.', 0, 0);
+    QMap<QString, QDateTime> keyTimes;
+    QMap<QString, qint64> keySizes;
+    QMap<QString, QStringList> keyPaths;
+    qint64 totalSize = 0;
+    foreach (const QFileInfo &info, QDir(cacheDir()).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QString key = info.fileName().section('.', 0, 0);
+        qint64 size = info.isDir() ? treeSize(info.filePath()) : info.size();
+        if (!keyTimes.contains(key) || info.lastModified() > keyTimes[key])
+            keyTimes[key] = info.lastModified();
+        keySizes[key] += size;
+        keyPaths[key].append(info.filePath());
+        totalSize += size;
+    }
+    if (totalSize <= maxCacheSize)
+        return;
+
+    // oldest first
+    QMultiMap<QDateTime, QString> keysByTime;
+    QMap<QString, QDateTime>::const_iterator it = keyTimes.constBegin();
+    for (; it != keyTimes.constEnd(); ++it)
+        keysByTime.insert(it.value(), it.key());
+    foreach (const QString &key, keysByTime) {
+        if (totalSize <= maxCacheSize)
+            break;
+        if (key == keptKey)
+            continue;
+        foreach (const QString &path, keyPaths[key]) {
+            if (QFileInfo(path).isDir())
+                removeTree(path);
+            else
+                QFile::remove(path);
+        }
+        totalSize -= keySizes[key];
+    }
+}
+
+// the cached layout of the dot file, laid out only once
+static QString layoutDotFile(const QString &dotFileName, QString *command)
+{
+    // the key of the graph: its contents and the layout options
+    QFile dotFile(dotFileName);
+    if (!dotFile.open(QIODevice::ReadOnly)) {
+        qWarning("Render::layoutDotFile: can't open '%s'", qPrintable(dotFileName));
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(dotFile.readAll());
+    hash.addData(layoutOptions);
+    dotFile.close();
+    QDir().mkpath(cacheDir());
+
+    QString layoutFileName = cacheDir() + "/" + QString::fromLatin1(hash.result().toHex()) + ".xdot";
+    if (!QFile::exists(layoutFileName)) {
+        QString layoutCommand = QString("dot -Txdot %1 -o%2 %3").arg(layoutOptions, "%1", dotFileName);
+        if (!execute(layoutCommand, layoutFileName, command))
+            return QString();
+    } else {
+        touch(layoutFileName);
+    }
+    return layoutFileName;
+}
+
+bool renderDotFile(const QString &dotFileName, const QString &type, const QString &outFileName, QString *command)
+{
+    QString layoutFileName = layoutDotFile(dotFileName, command);
+    if (layoutFileName.isEmpty())
+        return false;
+
+    // draw every type once, from the layout
+    QString cachedFileName = layoutFileName.section('.', 0, -2) + "." + type;
+    if (!QFile::exists(cachedFileName)) {
+        QString drawCommand = QString("neato -n2 -T%1 -o%2 %3").arg(type, "%1", layoutFileName);
+        if (!execute(drawCommand, cachedFileName, command))
+            return false;
+    }
+
+    QFile::remove(outFileName);
+    bool copied = QFile::copy(cachedFileName, outFileName);
+    pruneCache(layoutFileName);
+    return copied;
+}
+
+static const int tileSize = 256;
+// the tiles drawn by one process: the layout is read once per block, and a block image is 16MB at most
+static const int blockTiles = 8;
+
+struct Block {
+    QString tilesDir;
+    int level, firstX, firstY, columns, rows;
+    double centerX, centerY, zoom;
+    bool ok;
+    QString command;
+};
+
+static QString tileFileName(const Block &block, int tx, int ty)
+{
+    return QString("%1/%2/%3_%4.png").arg(block.tilesDir).arg(block.level).arg(tx).arg(ty);
+}
+
+struct RenderBlock {
+    RenderBlock(const QString &layoutFileName) : layoutFileName(layoutFileName) {}
+    // draws the block in one image, and cuts it in tiles: memory depends on the block, not on the graph
+    void operator()(Block &block) const {
+        block.ok = true;
+        bool missing = false;
+        for (int ty = block.firstY; ty < block.firstY + block.rows && !missing; ++ty)
+            for (int tx = block.firstX; tx < block.firstX + block.columns && !missing; ++tx)
+                missing = !QFile::exists(tileFileName(block, tx, ty));
+        if (!missing)
+            return;
+
+        int width = block.columns * tileSize, height = block.rows * tileSize;
+        QString viewport = QString("%1,%2,%3,%4,%5").arg(width).arg(height).arg(block.zoom, 0, 'f', 6)
+                .arg(block.centerX, 0, 'f', 2).arg(block.centerY, 0, 'f', 2);
+        QString drawCommand = QString("neato -n2 -Tpng -Gdpi=72 -Gpad=0 -Gviewport=%1 -o%2 %3")
+                .arg(viewport, "%1", layoutFileName);
+        QString blockFileName = QString("%1/%2/block_%3_%4.png").arg(block.tilesDir).arg(block.level)
+                .arg(block.firstX).arg(block.firstY);
+        if (!execute(drawCommand, blockFileName, &block.command)) {
+            block.ok = false;
+            return;
+        }
+        QImage image(blockFileName);
+        QFile::remove(blockFileName);
+        if (image.isNull()) {
+            block.ok = false;
+            block.command = drawCommand.arg(blockFileName);
+            return;
+        }
+
+        // every tile appears complete or not at all
+        for (int row = 0; row < block.rows; ++row) {
+            for (int column = 0; column < block.columns; ++column) {
+                QString fileName = tileFileName(block, block.firstX + column, block.firstY + row);
+                QImage tile = image.copy(column * tileSize, row * tileSize, tileSize, tileSize);
+                if (!tile.save(fileName + ".tmp", "PNG") || !QFile::rename(fileName + ".tmp", fileName)) {
+                    QFile::remove(fileName + ".tmp");
+                    block.ok = false;
+                }
+            }
+        }
+    }
+    const QString &layoutFileName;
+};
+
+// the bounding box of the graph, from the attributes of the layout
+static bool readBoundingBox(const QString &layoutFileName, double *x0, double *y0, double *x1, double *y1)
+{
+    QFile layoutFile(layoutFileName);
+    if (!layoutFile.open(QIODevice::ReadOnly))
+        return false;
+    QRegExp bbRx("bb=\"([-\\d.]+),([-\\d.]+),([-\\d.]+),([-\\d.]+)\"");
+    // the attributes of the graph come before any node
+    for (int i = 0; i < 64 && !layoutFile.atEnd(); ++i) {
+        QString line = QString::fromUtf8(layoutFile.readLine());
+        if (bbRx.indexIn(line) != -1) {
+            *x0 = bbRx.cap(1).toDouble();
+            *y0 = bbRx.cap(2).toDouble();
+            *x1 = bbRx.cap(3).toDouble();
+            *y1 = bbRx.cap(4).toDouble();
+            return *x1 > *x0 && *y1 > *y0;
+        }
+    }
+    return false;
+}
+
+bool renderDotTiles(const QString &dotFileName, const QString &outFileName, QString *command)
+{
+    QString layoutFileName = layoutDotFile(dotFileName, command);
+    if (layoutFileName.isEmpty())
+        return false;
+    double x0, y0, x1, y1;
+    if (!readBoundingBox(layoutFileName, &x0, &y0, &x1, &y1)) {
+        qWarning("Render::renderDotTiles: no bounding box in '%s'", qPrintable(layoutFileName));
+        return false;
+    }
+
+    // the last level has 1 pixel per point, and every level before it half the size
+    double width = x1 - x0, height = y1 - y0;
+    int levels = 1;
+    while ((qMax(width, height) / (1 << (levels - 1))) > tileSize)
+        ++levels;
+
+    QString tilesDir = layoutFileName.section('.', 0, -2) + ".tiles";
+    QList<Block> blocks;
+    QStringList levelSizes;
+    for (int level = 0; level < levels; ++level) {
+        QDir().mkpath(QString("%1/%2").arg(tilesDir).arg(level));
+        double zoom = 1.0 / (1 << (levels - 1 - level));
+        int levelWidth = qCeil(width * zoom), levelHeight = qCeil(height * zoom);
+        int tilesX = (levelWidth + tileSize - 1) / tileSize, tilesY = (levelHeight + tileSize - 1) / tileSize;
+        levelSizes.append(QString("[%1,%2]").arg(levelWidth).arg(levelHeight));
+        for (int ty = 0; ty < tilesY; ty += blockTiles) {
+            for (int tx = 0; tx < tilesX; tx += blockTiles) {
+                Block block;
+                block.tilesDir = tilesDir;
+                block.level = level;
+                block.firstX = tx;
+                block.firstY = ty;
+                block.columns = qMin(blockTiles, tilesX - tx);
+                block.rows = qMin(blockTiles, tilesY - ty);
+                block.centerX = x0 + (tx * tileSize + block.columns * tileSize / 2) / zoom;
+                block.centerY = y1 - (ty * tileSize + block.rows * tileSize / 2) / zoom;
+                block.zoom = zoom;
+                block.ok = false;
+                blocks.append(block);
+            }
+        }
+    }
+
+    // the tiles already drawn are kept, and the rest is drawn in parallel, a block at a time
+    QtConcurrent::blockingMap(blocks, RenderBlock(layoutFileName));
+    foreach (const Block &block, blocks) {
+        if (!block.ok) {
+            if (command)
+                *command = block.command;
+            return false;
+        }
+    }
+
+    // the viewer
+    QFile htmlFile(outFileName);
+    if (!htmlFile.open(QIODevice::WriteOnly)) {
+        qWarning("Render::renderDotTiles: can't write '%s'", qPrintable(outFileName));
+        return false;
+    }
+    QTextStream ts(&htmlFile);
+    ts << "<html><head><title>Graph of changes</title><style>" << "\n";
+    ts << "body { margin: 0; overflow: hidden; } #view { position: absolute; width: 100%; height: 100%; overflow: hidden; cursor: move; } #view img { position: absolute; }" << "\n";
+    ts << "</style></head><body><div id=\"view\"></div><script>" << "\n";
+    ts << "var tiles = \"" << QUrl::fromLocalFile(tilesDir).toString() << "\", size = " << tileSize << ", levels = [" << levelSizes.join(",") << "];" << "\n";
+    ts << viewerScript;
+    ts << "</script></body></html>" << "\n";
+    htmlFile.close();
+    pruneCache(layoutFileName);
+    return true;
+}
+
+} // namespace Render
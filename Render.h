@@ -0,0 +1,57 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <QString>
+
+/**
+  Renders dot files through a cache of layouts and outputs.
+
+  The layout (dot -Txdot) is the slow part, and it's keyed by the hash of the dot file and the
+  layout options: outputs in other formats are drawn from the cached layout with 'neato -n2',
+  which keeps all the positions, and outputs already drawn are just copied. Graphs too large for
+  a single image are drawn as tiles of the same layout, a block of tiles per process.
+
+  The least recently used graphs are removed when the cache grows beyond 1GB.
+*/
+namespace Render {
+
+    /// the folder of the cached layouts and outputs
+    QString cacheDir();
+
+    /// renders the dot file in the type (png, svg, pdf) to outFileName. on error, command is the one that failed
+    bool renderDotFile(const QString &dotFileName, const QString &type, const QString &outFileName, QString *command = 0);
+
+    /// renders the dot file as a pyramid of 256px tiles drawn in parallel, with an html viewer in outFileName
+    bool renderDotTiles(const QString &dotFileName, const QString &outFileName, QString *command = 0);
+
+} // namespace Render
+
+#endif // RENDER_H
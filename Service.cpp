@@ -0,0 +1,414 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Service.h"
+#include "Compare.h"
+#include "Export.h"
+#include <QBuffer>
+#include <QDir>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTime>
+#include <QUrl>
+
+namespace Service {
+
+// the deltas kept for the warm requests, counted in changes
+static const int maxCachedChanges = 1000000;
+
+static const int maxHeaderSize = 8192;
+static const char *requestedByValue = "view-branch-diff";
+
+// the longest wait for an answer, after which the client compares by itself
+static const int fetchTimeout = 120000;
+
+static void deleteHistory(Git::BranchHistory *history)
+{
+    history->clear();
+    delete history;
+}
+
+static QByteArray httpResponse(int code, const QByteArray &status, const QByteArray &contentType,
+                               const QByteArray &body, const QByteArray &extraHeaders = QByteArray())
+{
+    QByteArray response = "HTTP/1.0 " + QByteArray::number(code) + " " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += extraHeaders;
+    response += "\r\n";
+    response += body;
+    return response;
+}
+
+// answers a request on the pool, and hands the response back to the thread of the server
+class Request : public QRunnable {
+public:
+    Request(Server *server, const QString &request) : mServer(server), mRequest(request) {}
+    void run() {
+        QByteArray response = mServer->answer(mRequest);
+        QMetaObject::invokeMethod(mServer, "slotAnswered", Qt::QueuedConnection,
+                                  Q_ARG(QString, mRequest), Q_ARG(QByteArray, response));
+    }
+private:
+    Server *mServer;
+    QString mRequest;
+};
+
+// no spaces (they would split the command) and no options
+static bool isBranchName(const QString &name)
+{
+    foreach (const QChar &c, name)
+        if (c.isSpace() || c.category() == QChar::Other_Control)
+            return false;
+    return !name.startsWith('-');
+}
+
+Server::Server(QObject *parent)
+  : QTcpServer(parent)
+  , mDeltas(maxCachedChanges)
+{
+    mPool.setMaxThreadCount(QThread::idealThreadCount());
+    connect(this, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+}
+
+Server::~Server()
+{
+    close();
+    mPool.waitForDone();
+    mDeltas.clear();
+    mHistories.clear();
+    qDeleteAll(mLoadMutexes);
+}
+
+bool Server::start(quint16 port, const QStringList &roots)
+{
+    // only the repositories under the roots are served
+    mRoots.clear();
+    foreach (const QString &root, roots) {
+        QString canonicalRoot = QDir(root).canonicalPath();
+        if (canonicalRoot.isEmpty()) {
+            qWarning("Service::Server: the root '%s' doesn't exist", qPrintable(root));
+            return false;
+        }
+        mRoots.append(canonicalRoot);
+    }
+    if (mRoots.isEmpty()) {
+        qWarning("Service::Server: no repository roots to serve");
+        return false;
+    }
+
+    if (!listen(QHostAddress::LocalHost, port)) {
+        qWarning("Service::Server: can't listen on port %d: %s", port, qPrintable(errorString()));
+        return false;
+    }
+    return true;
+}
+
+void Server::slotNewConnection()
+{
+    while (QTcpSocket *socket = nextPendingConnection()) {
+        connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+static void reply(QTcpSocket *socket, const QByteArray &response)
+{
+    socket->write(response);
+    socket->disconnectFromHost();
+}
+
+void Server::slotReadRequest()
+{
+    // wait for the whole header: "GET /delta?... HTTP/1.x", then the fields up to an empty line
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket)
+        return;
+    QByteArray header = socket->peek(maxHeaderSize);
+    int headerEnd = header.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (header.size() >= maxHeaderSize) {
+            disconnect(socket, SIGNAL(readyRead()), this, SLOT(slotReadRequest()));
+            reply(socket, httpResponse(431, "Request Header Fields Too Large", "text/plain", "Header too large\n"));
+        }
+        return;
+    }
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(slotReadRequest()));
+    QList<QByteArray> lines = socket->read(headerEnd + 4).split('\n');
+    QList<QByteArray> tokens = lines.takeFirst().trimmed().split(' ');
+    if (tokens.size() < 2 || tokens[0] != "GET") {
+        reply(socket, httpResponse(405, "Method Not Allowed", "text/plain", "Only GET is supported\n"));
+        return;
+    }
+
+    // only local clients that mean it: pages of other sites have their own Host (DNS rebinding), and
+    // can't add the request header of the service without a preflight, which is never answered
+    QByteArray host, requestedBy;
+    foreach (const QByteArray &line, lines) {
+        int colon = line.indexOf(':');
+        QByteArray name = line.left(colon).trimmed().toLower();
+        if (name == "host")
+            host = line.mid(colon + 1).trimmed().toLower();
+        else if (name == "x-requested-by")
+            requestedBy = line.mid(colon + 1).trimmed();
+    }
+    QByteArray port = QByteArray::number(serverPort());
+    if (host != "localhost:" + port && host != "127.0.0.1:" + port) {
+        reply(socket, httpResponse(403, "Forbidden", "text/plain", "Only localhost is served\n"));
+        return;
+    }
+    if (requestedBy != requestedByValue) {
+        reply(socket, httpResponse(403, "Forbidden", "text/plain",
+                                   "The header 'X-Requested-By: " + QByteArray(requestedByValue) + "' is required\n"));
+        return;
+    }
+
+    // the same request already running will answer this one too
+    QString request = QString::fromLatin1(tokens[1]);
+    bool running = mWaiting.contains(request);
+    mWaiting[request].append(socket);
+    if (!running)
+        mPool.start(new Request(this, request));
+}
+
+void Server::slotAnswered(const QString &request, const QByteArray &response)
+{
+    foreach (const QPointer<QTcpSocket> &socket, mWaiting.take(request)) {
+        if (socket)
+            reply(socket, response);
+    }
+}
+
+QString Server::repositoryDir(const QString &dir) const
+{
+    QString canonicalDir = QDir(dir).canonicalPath();
+    if (canonicalDir.isEmpty())
+        return QString();
+    foreach (const QString &root, mRoots)
+        if (canonicalDir == root || canonicalDir.startsWith(root.endsWith('/') ? root : root + "/"))
+            return canonicalDir;
+    return QString();
+}
+
+QByteArray Server::answer(const QString &request)
+{
+    QUrl url = QUrl::fromEncoded(request.toLatin1());
+    QString path = url.path();
+    if (path != "/delta" && path != "/delta.log")
+        return httpResponse(404, "Not Found", "text/plain", "Unknown request, use /delta or /delta.log\n");
+    QString dir = url.queryItemValue("dir");
+    QString b1 = url.queryItemValue("b1");
+    QString b2 = url.queryItemValue("b2");
+    bool stats = url.queryItemValue("stats") == "1";
+    int budget = url.queryItemValue("budget").toInt() * 1000;
+    if (dir.isEmpty() || b2.isEmpty())
+        return httpResponse(400, "Bad Request", "text/plain", "dir and b2 are required\n");
+    if (!isBranchName(b1) || !isBranchName(b2))
+        return httpResponse(400, "Bad Request", "text/plain", "Invalid branch name\n");
+    dir = repositoryDir(dir);
+    if (dir.isEmpty())
+        return httpResponse(403, "Forbidden", "text/plain", "The repository is not under the served roots\n");
+
+    // the tips are resolved every time, so that the answer follows the branches
+    Git::SHA1 tip1 = b1.isEmpty() ? QString() : Compare::revParse(dir, b1);
+    Git::SHA1 tip2 = Compare::revParse(dir, b2);
+    if ((!b1.isEmpty() && tip1.isEmpty()) || tip2.isEmpty())
+        return httpResponse(404, "Not Found", "text/plain", "Cannot resolve the tips of the branches\n");
+    HistoryPointer history = delta(dir, b1, tip1, b2, tip2, stats, budget);
+    if (!history)
+        return httpResponse(500, "Internal Server Error", "text/plain", "Cannot read the log of the branches\n");
+
+    if (path == "/delta.log") {
+        QByteArray body = Git::formatLog(*history);
+        QByteArray sizeHeader = "X-Log-Size: " + QByteArray::number(body.size()) + "\r\n";
+        QMap<QString, QString>::const_iterator it = history->edgeDataMap.constBegin();
+        for (; it != history->edgeDataMap.constEnd(); ++it)
+            body += it.key().toLatin1() + '\t' + it.value().toLatin1() + '\n';
+        return httpResponse(200, "OK", "application/octet-stream", body, sizeHeader);
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    Export::Writer writer;
+    writer.open(&buffer);
+    writer.writeNodes(*history);
+    QMap<QString, QString>::const_iterator it = history->edgeDataMap.constBegin();
+    for (; it != history->edgeDataMap.constEnd(); ++it)
+        writer.writeEdge(it.key(), it.value());
+    writer.close();
+    return httpResponse(200, "OK", "application/x-ndjson", buffer.data());
+}
+
+Server::HistoryPointer Server::history(const QString &dir, const QString &branch, const Git::SHA1 &tip)
+{
+    QString key = dir + "\n" + branch;
+    {
+        QMutexLocker locker(&mMutex);
+        if (mHistories.contains(key) && mHistories[key].tip == tip)
+            return mHistories[key].history;
+    }
+
+    // one load at a time per branch, and maybe another request loaded it in the meantime
+    QMutex *loadMutex;
+    {
+        QMutexLocker locker(&mMutex);
+        loadMutex = mLoadMutexes.value(key);
+        if (!loadMutex) {
+            loadMutex = new QMutex;
+            mLoadMutexes.insert(key, loadMutex);
+        }
+    }
+    QMutexLocker loadLocker(loadMutex);
+    {
+        QMutexLocker locker(&mMutex);
+        if (mHistories.contains(key) && mHistories[key].tip == tip)
+            return mHistories[key].history;
+    }
+    bool ok = false;
+    Git::BranchHistory *history = new Git::BranchHistory(Compare::loadHistory(dir, branch, tip, &ok));
+    if (!ok) {
+        delete history;
+        return HistoryPointer();
+    }
+    Loaded loaded;
+    loaded.tip = tip;
+    loaded.history = HistoryPointer(history, deleteHistory);
+
+    // the previous history is deleted once the requests still using it are done
+    QMutexLocker locker(&mMutex);
+    mHistories[key] = loaded;
+    return loaded.history;
+}
+
+Server::HistoryPointer Server::delta(const QString &dir, const QString &b1, const Git::SHA1 &tip1,
+                                     const QString &b2, const Git::SHA1 &tip2, bool stats, int budget)
+{
+    QString key = (QStringList() << dir << tip1 << tip2 << (stats ? "stats" : "")).join("\n");
+    {
+        QMutexLocker locker(&mMutex);
+        if (HistoryPointer *cached = mDeltas.object(key))
+            return *cached;
+    }
+
+    // delta = 2 - 1
+    HistoryPointer h2 = history(dir, b2, tip2);
+    HistoryPointer h1 = tip1.isEmpty() ? HistoryPointer(new Git::BranchHistory) : history(dir, b1, tip1);
+    if (!h1 || !h2)
+        return HistoryPointer();
+    HistoryPointer delta(new Git::BranchHistory, deleteHistory);
+    *delta = Git::deltaHistory(*h2, *h1);
+
+    // the stats known from all the requests on the same repository
+    int pendingCount = 0;
+    if (stats) {
+        QMap<QString, QString> edgeStats;
+        {
+            QMutexLocker locker(&mMutex);
+            edgeStats = mEdgeStats.value(dir);
+        }
+        pendingCount = Compare::computeEdgeStats(dir, delta.data(), &edgeStats, budget);
+        QMutexLocker locker(&mMutex);
+        QMap<QString, QString> &knownStats = mEdgeStats[dir];
+        QMap<QString, QString>::const_iterator it = delta->edgeDataMap.constBegin();
+        for (; it != delta->edgeDataMap.constEnd(); ++it)
+            knownStats.insert(it.key(), it.value());
+    }
+
+    // only the complete deltas can answer again
+    if (!pendingCount) {
+        QMutexLocker locker(&mMutex);
+        mDeltas.insert(key, new HistoryPointer(delta), qMax(1, delta->changesFlatList.size()));
+    }
+    return delta;
+}
+
+bool fetchDelta(quint16 port, const QString &dir, const QString &b1, const QString &b2, bool stats,
+                int budget, Git::BranchHistory *delta, Compare::Progress *progress, int progressFrom, int progressTo)
+{
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, port);
+    if (!socket.waitForConnected(500))
+        return false;
+
+    QUrl url("/delta.log");
+    url.addQueryItem("dir", dir);
+    url.addQueryItem("b1", b1);
+    url.addQueryItem("b2", b2);
+    if (stats) {
+        url.addQueryItem("stats", "1");
+        url.addQueryItem("budget", QString::number(budget));
+    }
+    socket.write("GET " + url.toEncoded() + " HTTP/1.0\r\nHost: localhost:" + QByteArray::number(port) + "\r\n"
+                 "X-Requested-By: " + requestedByValue + "\r\n\r\n");
+
+    // the service closes the connection after the answer, which can take long on a cold history:
+    // wait in short steps, to let the progress update the caller
+    QByteArray response;
+    QTime timing;
+    timing.start();
+    while (socket.state() == QAbstractSocket::ConnectedState) {
+        if (timing.elapsed() > fetchTimeout) {
+            qWarning("Service::fetchDelta: no answer in %d seconds", fetchTimeout / 1000);
+            return false;
+        }
+        if (socket.waitForReadyRead(100))
+            response += socket.readAll();
+        if (progress)
+            progress->setProgress(progressFrom + ((progressTo - progressFrom) * timing.elapsed()) / fetchTimeout);
+    }
+    response += socket.readAll();
+
+    int headerEnd = response.indexOf("\r\n\r\n");
+    if (headerEnd < 0 || !response.startsWith("HTTP/1.0 200")) {
+        qWarning("Service::fetchDelta: %s", response.left(response.indexOf('\n')).constData());
+        return false;
+    }
+    QByteArray body = response.mid(headerEnd + 4);
+    int logSize = -1;
+    foreach (const QByteArray &header, response.left(headerEnd).split('\n')) {
+        if (header.startsWith("X-Log-Size:"))
+            logSize = header.mid(11).trimmed().toInt();
+    }
+    if (logSize < 0 || logSize > body.size()) {
+        qWarning("Service::fetchDelta: incomplete answer");
+        return false;
+    }
+
+    *delta = Git::parseLogToHistory(body.left(logSize));
+    foreach (const QByteArray &line, body.mid(logSize).split('\n')) {
+        int tab = line.indexOf('\t');
+        if (tab > 0)
+            delta->edgeDataMap[QString::fromLatin1(line.left(tab))] = QString::fromLatin1(line.mid(tab + 1));
+    }
+    return true;
+}
+
+} // namespace Service
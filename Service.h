@@ -0,0 +1,112 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <QCache>
+#include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTcpServer>
+#include <QThreadPool>
+#include "Compare.h"
+#include "GitStructure.h"
+class QTcpSocket;
+
+namespace Service {
+
+    /// the port of the service on localhost, if not specified
+    const quint16 defaultPort = 7878;
+
+    /**
+      Serves the comparisons over HTTP on localhost, keeping the histories of the branches and the
+      stats of the edges in memory across requests, so that a warm comparison is answered without
+      reading the log again:
+        GET /delta?dir=..&b1=..&b2=..[&stats=1][&budget=seconds]
+            the delta of b2 over b1 (b1 can be empty), in the JSON Lines format of Export
+        GET /delta.log?...
+            the same delta in the format of Git::logCommand (its size is in the X-Log-Size header),
+            followed by one "diff<TAB>stats" line per edge with stats
+
+      Requests run on a pool of threads, and identical requests that arrive while one is running
+      wait for the same answer. Only the repositories under the roots are served, and only to
+      requests with Host set to localhost:port (or 127.0.0.1:port) and the header
+      "X-Requested-By: view-branch-diff", which pages of other sites can't send.
+    */
+    class Server : public QTcpServer {
+        Q_OBJECT
+    public:
+        explicit Server(QObject *parent = 0);
+        ~Server();
+
+        /// starts listening on localhost, serving only the repositories under the roots
+        bool start(quint16 port, const QStringList &roots);
+
+        /// the whole HTTP response to the request (path and query), called from the pool
+        QByteArray answer(const QString &request);
+
+    private slots:
+        void slotNewConnection();
+        void slotReadRequest();
+        void slotAnswered(const QString &request, const QByteArray &response);
+
+    private:
+        QString repositoryDir(const QString &dir) const;
+        typedef QSharedPointer<Git::BranchHistory> HistoryPointer;
+        struct Loaded {
+            Git::SHA1 tip;
+            HistoryPointer history;
+        };
+        HistoryPointer history(const QString &dir, const QString &branch, const Git::SHA1 &tip);
+        HistoryPointer delta(const QString &dir, const QString &b1, const Git::SHA1 &tip1,
+                             const QString &b2, const Git::SHA1 &tip2, bool stats, int budget);
+
+        QThreadPool mPool;
+        QStringList mRoots;
+        QMap<QString, QList<QPointer<QTcpSocket> > > mWaiting;
+
+        // shared by the pool, and guarded by mMutex; mLoadMutexes serialise the loads of each branch
+        QMutex mMutex;
+        QMap<QString, QMutex *> mLoadMutexes;
+        QMap<QString, Loaded> mHistories;
+        QMap<QString, QMap<QString, QString> > mEdgeStats;
+        QCache<QString, HistoryPointer> mDeltas;
+    };
+
+    /// asks the service for the delta, with the stats of its edges if requested, reporting the progress
+    /// while waiting. false if not answered within 2 minutes
+    bool fetchDelta(quint16 port, const QString &dir, const QString &b1, const QString &b2, bool stats,
+                    int budget, Git::BranchHistory *delta, Compare::Progress *progress = 0,
+                    int progressFrom = 0, int progressTo = 100);
+
+} // namespace Service
+
+#endif // SERVICE_H
@@ -0,0 +1,186 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "Snapshot.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QtEndian>
+#include <string.h>
+
+namespace Snapshot {
+
+static const quint32 version = 1;
+static const int headerSize = 4 + 4 * 4 + 20;
+static const int changeSize = 20 + 8 + 6 * 4;
+static const int sha1Size = 20;
+
+static QString hashName(const QString &text)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+static void writeSha1(QDataStream &ds, const Git::SHA1 &sha1)
+{
+    QByteArray raw = QByteArray::fromHex(sha1.toLatin1()).leftJustified(sha1Size, '\0', true);
+    ds.writeRawData(raw.constData(), sha1Size);
+}
+
+static Git::SHA1 readSha1(const uchar *data)
+{
+    return QString::fromLatin1(QByteArray::fromRawData((const char *)data, sha1Size).toHex());
+}
+
+QString fileName(const QString &repoDir, const QString &branch)
+{
+    QString repoName = hashName(QDir(repoDir).canonicalPath());
+    return QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + "/snapshots/" +
+            repoName + "/" + hashName(branch) + ".snapshot";
+}
+
+bool save(const QString &fileName, const Git::BranchHistory &history, const Git::SHA1 &tip)
+{
+    // lay out the strings and the parents first
+    QByteArray strings;
+    QHash<QString, QPair<quint32, quint32> > authorStrings;
+    QList<QPair<quint32, quint32> > subjects;
+    quint32 parentsCount = 0;
+    foreach (const Git::Change *change, history.changesFlatList) {
+        if (!authorStrings.contains(change->author)) {
+            QByteArray author = change->author.toUtf8();
+            authorStrings[change->author] = qMakePair((quint32)strings.size(), (quint32)author.size());
+            strings.append(author);
+        }
+        QByteArray subject = change->subject().toUtf8();
+        subjects.append(qMakePair((quint32)strings.size(), (quint32)subject.size()));
+        strings.append(subject);
+        parentsCount += change->parentUids.size();
+    }
+
+    // write to a temporary file, replacing the snapshot only when complete
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QFile file(fileName + ".new");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Snapshot::save: can't open output file '%s' for writing", qPrintable(file.fileName()));
+        return false;
+    }
+    QDataStream ds(&file);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds.writeRawData("VBDS", 4);
+    ds << version << (quint32)history.changesFlatList.size() << parentsCount << (quint32)strings.size();
+    writeSha1(ds, tip);
+
+    quint32 parentIndex = 0;
+    for (int i = 0; i < history.changesFlatList.size(); ++i) {
+        const Git::Change *change = history.changesFlatList[i];
+        const QPair<quint32, quint32> &author = authorStrings[change->author];
+        writeSha1(ds, change->commitUid);
+        ds << (qint64)change->timestamp << parentIndex << (quint32)change->parentUids.size()
+           << author.first << author.second << subjects[i].first << subjects[i].second;
+        parentIndex += change->parentUids.size();
+    }
+    foreach (const Git::Change *change, history.changesFlatList)
+        foreach (const Git::SHA1 &parentId, change->parentUids)
+            writeSha1(ds, parentId);
+    ds.writeRawData(strings.constData(), strings.size());
+
+    if (ds.status() != QDataStream::Ok || !file.flush()) {
+        qWarning("Snapshot::save: error writing '%s'", qPrintable(file.fileName()));
+        file.remove();
+        return false;
+    }
+    file.close();
+    QFile::remove(fileName);
+    return file.rename(fileName);
+}
+
+bool load(const QString &fileName, Git::BranchHistory *history, Git::SHA1 *tip)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < headerSize)
+        return false;
+    const uchar *data = file.map(0, file.size());
+    if (!data) {
+        qWarning("Snapshot::load: can't map '%s'", qPrintable(fileName));
+        return false;
+    }
+
+    // validate the header against the size of the file
+    quint32 changesCount = qFromLittleEndian<quint32>(data + 8);
+    quint32 parentsCount = qFromLittleEndian<quint32>(data + 12);
+    quint32 stringsSize = qFromLittleEndian<quint32>(data + 16);
+    qint64 parentsStart = headerSize + (qint64)changesCount * changeSize;
+    qint64 stringsStart = parentsStart + (qint64)parentsCount * sha1Size;
+    if (memcmp(data, "VBDS", 4) || qFromLittleEndian<quint32>(data + 4) != version ||
+            stringsStart + stringsSize != file.size()) {
+        qWarning("Snapshot::load: '%s' is not valid, ignoring it", qPrintable(fileName));
+        return false;
+    }
+    const char *strings = (const char *)data + stringsStart;
+
+    // create all the changes, sharing the strings of the same authors
+    QList<Git::Change *> changes;
+    QHash<quint32, QString> authors;
+    for (quint32 i = 0; i < changesCount; ++i) {
+        const uchar *record = data + headerSize + (qint64)i * changeSize;
+        quint32 parentIndex = qFromLittleEndian<quint32>(record + 28);
+        quint32 parentCount = qFromLittleEndian<quint32>(record + 32);
+        quint32 authorOffset = qFromLittleEndian<quint32>(record + 36);
+        quint32 authorSize = qFromLittleEndian<quint32>(record + 40);
+        quint32 subjectOffset = qFromLittleEndian<quint32>(record + 44);
+        quint32 subjectSize = qFromLittleEndian<quint32>(record + 48);
+        if ((qint64)parentIndex + parentCount > parentsCount || (qint64)authorOffset + authorSize > stringsSize ||
+                (qint64)subjectOffset + subjectSize > stringsSize) {
+            qWarning("Snapshot::load: '%s' is corrupted, ignoring it", qPrintable(fileName));
+            qDeleteAll(changes);
+            return false;
+        }
+
+        Git::Change *change = new Git::Change;
+        change->commitUid = readSha1(record);
+        change->shortUid = change->commitUid.left(8);
+        change->timestamp = qFromLittleEndian<qint64>(record + 20);
+        if (!authors.contains(authorOffset))
+            authors[authorOffset] = QString::fromUtf8(strings + authorOffset, authorSize);
+        change->author = authors[authorOffset];
+        change->message = QString::fromUtf8(strings + subjectOffset, subjectSize);
+        for (quint32 p = 0; p < parentCount; ++p)
+            change->parentUids.append(readSha1(data + parentsStart + (qint64)(parentIndex + p) * sha1Size));
+        changes.append(change);
+    }
+
+    *tip = readSha1(data + 20);
+    *history = Git::buildHistory(changes);
+    return true;
+}
+
+} // namespace Snapshot
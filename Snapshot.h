@@ -0,0 +1,59 @@
+/*
+  Copyright (C) 2011, Enrico Ros <enrico.ros@gmail.com>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QString>
+#include "GitStructure.h"
+
+/**
+  Snapshots of parsed histories, to reload them without asking git for the whole log again.
+
+  A snapshot is a binary file (little endian), memory mapped on load:
+    header:  "VBDS", u32 version, u32 changes count, u32 parents count, u32 strings size, tip sha[20]
+    changes: sha[20], i64 timestamp, u32 first parent, u32 parents count,
+             u32 author offset, u32 author size, u32 subject offset, u32 subject size
+    parents: sha[20] each, the parents of every change are consecutive and in order
+    strings: UTF-8 text, every author is stored once
+  changes are in log order (children first), and only keep the subject of the message.
+*/
+namespace Snapshot {
+
+    /// returns where the snapshot of the branch in the repository is kept
+    QString fileName(const QString &repoDir, const QString &branch);
+
+    /// saves the history, that was logged from the tip
+    bool save(const QString &fileName, const Git::BranchHistory &history, const Git::SHA1 &tip);
+
+    /// loads a history saved with save, and the tip it was logged from
+    bool load(const QString &fileName, Git::BranchHistory *history, Git::SHA1 *tip);
+
+} // namespace Snapshot
+
+#endif // SNAPSHOT_H
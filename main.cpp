@@ -26,15 +26,41 @@
 */
 
 #include <QtGui/QApplication>
+#include <QSettings>
+#include <QStringList>
 #include "MainWindow.h"
+#include "Service.h"
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    // --daemon [port] serves the comparisons, without any window
+    int daemonArg = 0;
+    for (int i = 1; i < argc && !daemonArg; ++i)
+        if (QString(argv[i]) == "--daemon")
+            daemonArg = i;
+
+    QApplication a(argc, argv, !daemonArg);
     a.setApplicationName("GitVisDiff");
     a.setApplicationVersion("1.0");
     a.setOrganizationName("WebTech");
 
+    if (daemonArg) {
+        // --root DIR (any number of times) or the Service/Roots setting: the repositories to serve
+        QStringList args = a.arguments();
+        quint16 port = args.value(args.indexOf("--daemon") + 1).toUShort();
+        QStringList roots;
+        for (int i = args.indexOf("--root"); i != -1 && i + 1 < args.size(); i = args.indexOf("--root", i + 2))
+            roots.append(args[i + 1]);
+        if (roots.isEmpty())
+            roots = QSettings().value("Service/Roots").toStringList();
+        Service::Server server;
+        if (!server.start(port ? port : Service::defaultPort, roots)) {
+            qWarning("usage: view-branch-diff --daemon [port] --root <repositories dir> [--root ...]");
+            return 1;
+        }
+        return a.exec();
+    }
+
     MainWindow w;
     w.show();
 
@@ -1,4 +1,4 @@
-QT = core gui
+QT = core gui network
 
 CONFIG += console
 TARGET = view-branch-diff
@@ -8,12 +8,24 @@ SOURCES += \
     main.cpp \
     MainWindow.cpp \
     GitStructure.cpp \
-    Console.cpp
+    Compare.cpp \
+    Console.cpp \
+    Export.cpp \
+    Filter.cpp \
+    Render.cpp \
+    Service.cpp \
+    Snapshot.cpp
 
 HEADERS += \
     MainWindow.h \
     GitStructure.h \
-    Console.h
+    Compare.h \
+    Console.h \
+    Export.h \
+    Filter.h \
+    Render.h \
+    Service.h \
+    Snapshot.h
 
 FORMS += \
     MainWindow.ui